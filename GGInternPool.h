@@ -0,0 +1,93 @@
+#ifndef GGINTERNPOOL_H
+#define GGINTERNPOOL_H
+
+#include <QHash>
+#include <QVector>
+
+/* ------------------------------------------------------------------------- */
+
+/**
+ * Values shared by key and reference counted, each one stored once however many times it is
+ * interned, and designated by a 32 bits handle. Handle 0 is never returned: it stands for no value.
+ *
+ * intern() and release() are O(1) on average. The handles of released values are reused.
+ * The cost given to intern() is summed in bytes(), for memory reports.
+ */
+template<class Key, class Value>
+class GGInternPool
+{
+public:
+    GGInternPool() : m_iBytes(0) {}
+
+    inline int size() const { return m_hashHandles.size(); }
+    inline qint64 bytes() const { return m_iBytes; }
+    inline int capacity() const { return m_aEntries.capacity(); }
+
+    inline const Value& value(quint32 handle) const { return handle ? m_aEntries.at(handle - 1).value : m_nullValue; }
+
+    quint32 intern(const Key& key, const Value& value, int cost = 0)
+    {
+        quint32 handle = m_hashHandles.value(key, 0);
+        if( handle ) {
+            ++m_aEntries[handle - 1].refs;
+            return handle;
+        }
+
+        if( m_lFreeHandles.isEmpty() ) {
+            m_aEntries.append(Entry());
+            handle = quint32(m_aEntries.size());
+        } else {
+            handle = m_lFreeHandles.takeLast();
+        }
+        Entry& entry = m_aEntries[handle - 1];
+        entry.key = key;
+        entry.value = value;
+        entry.refs = 1;
+        entry.cost = cost;
+        m_hashHandles.insert(key, handle);
+        m_iBytes += cost;
+        return handle;
+    }
+
+    void release(quint32 handle)
+    {
+        if( !handle ) { return; }
+
+        Entry& entry = m_aEntries[handle - 1];
+        if( 0 < --entry.refs ) { return; }
+
+        m_hashHandles.remove(entry.key);
+        m_iBytes -= entry.cost;
+        entry = Entry();
+        m_lFreeHandles.append(handle);
+    }
+
+    void clear()
+    {
+        m_aEntries.clear();
+        m_lFreeHandles.clear();
+        m_hashHandles.clear();
+        m_iBytes = 0;
+    }
+
+private:
+    struct Entry {
+        Entry() : refs(0), cost(0) {}
+        Key     key;
+        Value   value;
+        int     refs;
+        int     cost;
+    };
+
+    GGInternPool(const GGInternPool&);
+    GGInternPool& operator=(const GGInternPool&);
+
+private:
+    QVector<Entry>          m_aEntries;     //At handle - 1.
+    QVector<quint32>        m_lFreeHandles;
+    QHash<Key, quint32>     m_hashHandles;
+    Value                   m_nullValue;
+    qint64                  m_iBytes;
+};
+
+#endif // GGINTERNPOOL_H
@@ -0,0 +1,247 @@
+#ifndef GGRANKEDSET_H
+#define GGRANKEDSET_H
+
+#include <QVector>
+
+/* ------------------------------------------------------------------------- */
+
+/**
+ * Sorted set of keys, which also gives the rank of a key and the key at a rank.
+ *
+ * insert(), remove(), contains(), rank(), lowerBound() and at() are O(log n) on average: the keys
+ * are kept in a treap whose nodes count the keys below them. assignSorted() and toVector() are O(n).
+ * Key must provide operator<.
+ */
+template<class Key>
+class GGRankedSet
+{
+public:
+    GGRankedSet() : m_pRoot(nullptr), m_iSeed(2463534242u) {}
+    ~GGRankedSet() { this->clear(); }
+
+    inline int size() const { return _count(m_pRoot); }
+    inline bool isEmpty() const { return !m_pRoot; }
+    inline bool contains(const Key& key) const { return this->rank(key) >= 0; }
+
+    /* Number of keys less than key: the rank key has, or would have once inserted. */
+    int lowerBound(const Key& key) const
+    {
+        int rank = 0;
+        for( Node* pNode = m_pRoot; pNode; ) {
+            if( pNode->key < key ) {
+                rank += _count(pNode->pLeft) + 1;
+                pNode = pNode->pRight;
+            } else {
+                pNode = pNode->pLeft;
+            }
+        }
+        return rank;
+    }
+
+    /* -1 if key is not in the set. */
+    int rank(const Key& key) const
+    {
+        int rank = 0;
+        for( Node* pNode = m_pRoot; pNode; ) {
+            if( key < pNode->key ) {
+                pNode = pNode->pLeft;
+            } else if( pNode->key < key ) {
+                rank += _count(pNode->pLeft) + 1;
+                pNode = pNode->pRight;
+            } else {
+                return rank + _count(pNode->pLeft);
+            }
+        }
+        return -1;
+    }
+
+    /* rank must be in [0, size()). */
+    const Key& at(int rank) const
+    {
+        Node* pNode = m_pRoot;
+        for( ;; ) {
+            int left = _count(pNode->pLeft);
+            if( rank < left ) {
+                pNode = pNode->pLeft;
+            } else if( rank > left ) {
+                rank -= left + 1;
+                pNode = pNode->pRight;
+            } else {
+                return pNode->key;
+            }
+        }
+    }
+
+    /* Returns false if key was already in the set. */
+    bool insert(const Key& key)
+    {
+        if( this->contains(key) ) { return false; }
+
+        m_pRoot = this->insertNode(m_pRoot, new Node(key, this->nextPriority()));
+        return true;
+    }
+
+    bool remove(const Key& key)
+    {
+        if( !this->contains(key) ) { return false; }
+
+        m_pRoot = this->removeNode(m_pRoot, key);
+        return true;
+    }
+
+    void clear()
+    {
+        _destroy(m_pRoot);
+        m_pRoot = nullptr;
+    }
+
+    /* The keys in order, in O(n). */
+    QVector<Key> toVector() const
+    {
+        QVector<Key> keys;
+        keys.reserve(this->size());
+        _appendKeys(m_pRoot, keys);
+        return keys;
+    }
+
+    /* Replaces the keys with keys, which must be sorted and distinct. */
+    void assignSorted(const QVector<Key>& keys)
+    {
+        this->clear();
+
+        //Cartesian tree of the priorities: the right spine is kept on a stack.
+        QVector<Node*> lSpine;
+        for( int i = 0; i < keys.size(); ++i ) {
+            Node* pNode = new Node(keys.at(i), this->nextPriority());
+            Node* pLeft = nullptr;
+            while( !lSpine.isEmpty() && lSpine.last()->priority < pNode->priority ) {
+                pLeft = lSpine.takeLast();
+            }
+            pNode->pLeft = pLeft;
+            if( !lSpine.isEmpty() ) {
+                lSpine.last()->pRight = pNode;
+            }
+            lSpine.append(pNode);
+        }
+        m_pRoot = lSpine.isEmpty() ? nullptr : lSpine.first();
+        _updateCounts(m_pRoot);
+    }
+
+private:
+    struct Node {
+        Node(const Key& k, quint32 p) : key(k), priority(p), count(1), pLeft(nullptr), pRight(nullptr) {}
+        Key     key;
+        quint32 priority;   //Greater than those of the nodes below.
+        int     count;      //Of the keys of this subtree.
+        Node*   pLeft;
+        Node*   pRight;
+    };
+
+    static inline int _count(const Node* pNode) { return pNode ? pNode->count : 0; }
+    static inline void _recount(Node* pNode) { pNode->count = _count(pNode->pLeft) + _count(pNode->pRight) + 1; }
+
+    static void _destroy(Node* pNode)
+    {
+        if( !pNode ) { return; }
+        _destroy(pNode->pLeft);
+        _destroy(pNode->pRight);
+        delete pNode;
+    }
+
+    static void _appendKeys(const Node* pNode, QVector<Key>& keys)
+    {
+        if( !pNode ) { return; }
+        _appendKeys(pNode->pLeft, keys);
+        keys.append(pNode->key);
+        _appendKeys(pNode->pRight, keys);
+    }
+
+    static int _updateCounts(Node* pNode)
+    {
+        if( !pNode ) { return 0; }
+        pNode->count = _updateCounts(pNode->pLeft) + _updateCounts(pNode->pRight) + 1;
+        return pNode->count;
+    }
+
+    /* Xorshift: the priorities only need to be spread, not unpredictable. */
+    inline quint32 nextPriority()
+    {
+        m_iSeed ^= m_iSeed << 13;
+        m_iSeed ^= m_iSeed >> 17;
+        m_iSeed ^= m_iSeed << 5;
+        return m_iSeed;
+    }
+
+    Node* insertNode(Node* pNode, Node* pNew)
+    {
+        if( !pNode ) { return pNew; }
+
+        ++pNode->count;
+        if( pNew->key < pNode->key ) {
+            pNode->pLeft = this->insertNode(pNode->pLeft, pNew);
+            if( pNode->pLeft->priority > pNode->priority ) {
+                Node* pTop = pNode->pLeft;
+                pNode->pLeft = pTop->pRight;
+                pTop->pRight = pNode;
+                _recount(pNode);
+                _recount(pTop);
+                return pTop;
+            }
+        } else {
+            pNode->pRight = this->insertNode(pNode->pRight, pNew);
+            if( pNode->pRight->priority > pNode->priority ) {
+                Node* pTop = pNode->pRight;
+                pNode->pRight = pTop->pLeft;
+                pTop->pLeft = pNode;
+                _recount(pNode);
+                _recount(pTop);
+                return pTop;
+            }
+        }
+        return pNode;
+    }
+
+    /* key must be in the subtree. */
+    Node* removeNode(Node* pNode, const Key& key)
+    {
+        if( key < pNode->key ) {
+            pNode->pLeft = this->removeNode(pNode->pLeft, key);
+            --pNode->count;
+            return pNode;
+        }
+        if( pNode->key < key ) {
+            pNode->pRight = this->removeNode(pNode->pRight, key);
+            --pNode->count;
+            return pNode;
+        }
+
+        Node* pMerged = _merge(pNode->pLeft, pNode->pRight);
+        delete pNode;
+        return pMerged;
+    }
+
+    /* The keys of pLeft are all less than those of pRight. */
+    static Node* _merge(Node* pLeft, Node* pRight)
+    {
+        if( !pLeft ) { return pRight; }
+        if( !pRight ) { return pLeft; }
+
+        if( pLeft->priority > pRight->priority ) {
+            pLeft->pRight = _merge(pLeft->pRight, pRight);
+            _recount(pLeft);
+            return pLeft;
+        }
+        pRight->pLeft = _merge(pLeft, pRight->pLeft);
+        _recount(pRight);
+        return pRight;
+    }
+
+    GGRankedSet(const GGRankedSet&);
+    GGRankedSet& operator=(const GGRankedSet&);
+
+private:
+    Node*   m_pRoot;
+    quint32 m_iSeed;
+};
+
+#endif // GGRANKEDSET_H
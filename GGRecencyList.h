@@ -0,0 +1,136 @@
+#ifndef GGRECENCYLIST_H
+#define GGRECENCYLIST_H
+
+#include <QHash>
+#include <QList>
+
+/* ------------------------------------------------------------------------- */
+
+/**
+ * Keys ordered from the most to the least recently touched.
+ *
+ * touch(), append(), remove(), contains(), mostRecent() and leastRecent() are O(1): the keys
+ * are kept in a doubly linked list, indexed by a hash. toList(count) is O(count).
+ */
+template<class Key>
+class GGRecencyList
+{
+public:
+    GGRecencyList() : m_pFirst(nullptr), m_pLast(nullptr) {}
+    ~GGRecencyList() { this->clear(); }
+
+    inline int size() const { return m_hashNodes.size(); }
+    inline bool isEmpty() const { return m_hashNodes.isEmpty(); }
+    inline bool contains(const Key& key) const { return m_hashNodes.contains(key); }
+
+    //Must not be called on an empty list.
+    inline const Key& mostRecent() const { return m_pFirst->key; }
+    inline const Key& leastRecent() const { return m_pLast->key; }
+
+    /* Makes key the most recent one, adding it if needed. */
+    void touch(const Key& key)
+    {
+        Node* pNode = m_hashNodes.value(key, nullptr);
+        if( pNode ) {
+            if( pNode == m_pFirst ) { return; }
+            this->unlink(pNode);
+        } else {
+            pNode = new Node(key);
+            m_hashNodes.insert(key, pNode);
+        }
+        pNode->pNext = m_pFirst;
+        if( m_pFirst ) {
+            m_pFirst->pPrevious = pNode;
+        }
+        m_pFirst = pNode;
+        if( !m_pLast ) {
+            m_pLast = pNode;
+        }
+    }
+
+    /* Adds key as the least recent one, if it is not in the list yet. */
+    void append(const Key& key)
+    {
+        if( m_hashNodes.contains(key) ) { return; }
+
+        Node* pNode = new Node(key);
+        m_hashNodes.insert(key, pNode);
+        pNode->pPrevious = m_pLast;
+        if( m_pLast ) {
+            m_pLast->pNext = pNode;
+        }
+        m_pLast = pNode;
+        if( !m_pFirst ) {
+            m_pFirst = pNode;
+        }
+    }
+
+    bool remove(const Key& key)
+    {
+        Node* pNode = m_hashNodes.take(key);
+        if( !pNode ) { return false; }
+
+        this->unlink(pNode);
+        delete pNode;
+        return true;
+    }
+
+    void clear()
+    {
+        while( m_pFirst ) {
+            Node* pNext = m_pFirst->pNext;
+            delete m_pFirst;
+            m_pFirst = pNext;
+        }
+        m_pLast = nullptr;
+        m_hashNodes.clear();
+    }
+
+    /* The count most recent keys, all of them if count is negative, from the most recent. */
+    QList<Key> toList(int count = -1) const
+    {
+        if( count < 0 || count > m_hashNodes.size() ) {
+            count = m_hashNodes.size();
+        }
+        QList<Key> keys;
+        keys.reserve(count);
+        for( Node* pNode = m_pFirst; pNode && keys.size() < count; pNode = pNode->pNext ) {
+            keys.append(pNode->key);
+        }
+        return keys;
+    }
+
+private:
+    struct Node {
+        explicit Node(const Key& k) : key(k), pPrevious(nullptr), pNext(nullptr) {}
+        Key     key;
+        Node*   pPrevious;
+        Node*   pNext;
+    };
+
+    void unlink(Node* pNode)
+    {
+        if( pNode->pPrevious ) {
+            pNode->pPrevious->pNext = pNode->pNext;
+        } else {
+            m_pFirst = pNode->pNext;
+        }
+        if( pNode->pNext ) {
+            pNode->pNext->pPrevious = pNode->pPrevious;
+        } else {
+            m_pLast = pNode->pPrevious;
+        }
+        pNode->pPrevious = nullptr;
+        pNode->pNext = nullptr;
+    }
+
+    GGRecencyList(const GGRecencyList&);
+    GGRecencyList& operator=(const GGRecencyList&);
+
+private:
+    QHash<Key, Node*>   m_hashNodes;
+    Node*               m_pFirst;   //Most recent.
+    Node*               m_pLast;    //Least recent.
+};
+
+#endif // GGRECENCYLIST_H
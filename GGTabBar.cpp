@@ -1,38 +1,2066 @@
 #include "GGTabBar.h"
+#include "GGTabBarProfiler.h"
+#include "GGTabIconCache.h"
+#include "GGTabMenu.h"
+#include "GGTabSession.h"
+#include "GGTabUpdateQueue.h"
 
+#include <QAbstractButton>
+#include <QAtomicInt>
+#include <QApplication>
+#include <QCursor>
+#include <QFontMetrics>
 #include <QGlobal.h>
 #include <QHBoxLayout>
-#include <QMenu>
+#include <QHelpEvent>
+#include <QKeyEvent>
 #include <QMouseEvent>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QRunnable>
 #include <QScrollBar>
+#include <QSemaphore>
+#include <QShortcut>
+#include <QStackedWidget>
+#include <QStyleOptionTab>
+#include <QStylePainter>
+#include <QThreadPool>
 #include <QTimer>
+#include <QToolTip>
+#include <QVBoxLayout>
+#include <QWhatsThis>
+
+/* ------------------------------------------------------------------------- */
+
+static inline bool
+_isVerticalShape(QTabBar::Shape shape)
+{
+    return shape == QTabBar::RoundedWest  || shape == QTabBar::RoundedEast
+        || shape == QTabBar::TriangularWest || shape == QTabBar::TriangularEast;
+}
+
+static inline QString
+_badgeText(int count)
+{
+    return count > 99 ? QString("99+") : QString::number(count);
+}
+
+/* Estimated memory of a string: the QString, the header of its data and its characters. */
+static inline qint64
+_stringBytes(const QString& s)
+{
+    return s.isEmpty() ? 0 : qint64(sizeof(QString)) + 24 + s.size() * qint64(sizeof(QChar));
+}
+
+/* The text QTabBar::minimumTabSizeHint() measures in place of the text of a tab (see QTabBar). */
+static QString
+_minimumElidedText(Qt::TextElideMode mode, const QString& text)
+{
+    if( text.length() <= 3 ) { return text; }
+
+    switch( mode ) {
+    case Qt::ElideRight:  return text.left(2) + QLatin1String("...");
+    case Qt::ElideMiddle: return text.left(1) + QLatin1String("...") + text.right(1);
+    case Qt::ElideLeft:   return QLatin1String("...") + text.right(2);
+    default:              return text;
+    }
+}
+
+/* Models usually give a QBrush for Qt::ForegroundRole. */
+static QColor
+_variantColor(const QVariant& v)
+{
+    if( QMetaType::QBrush == v.userType() ) {
+        return qvariant_cast<QBrush>(v).color();
+    }
+    return qvariant_cast<QColor>(v);
+}
+
+/*
+ * Outside of an update and of coalesced notifications, the current tab changes and the moves are
+ * forwarded signal to signal: an update reports them by tabsChanged() alone.
+ */
+template<typename Receiver>
+static void
+_forwardIndexSignals(GGTabBar* pTabBar, Receiver* pReceiver, bool bForward)
+{
+    if( bForward ) {
+        QObject::connect(pTabBar, &QTabBar::currentChanged, pReceiver, &Receiver::currentChanged, Qt::UniqueConnection);
+        QObject::connect(pTabBar, &QTabBar::tabMoved,       pReceiver, &Receiver::tabMoved,       Qt::UniqueConnection);
+    } else {
+        QObject::disconnect(pTabBar, &QTabBar::currentChanged, pReceiver, &Receiver::currentChanged);
+        QObject::disconnect(pTabBar, &QTabBar::tabMoved,       pReceiver, &Receiver::tabMoved);
+    }
+}
+
+static inline bool
+_hasTabButton(const QTabBar* pTabBar, int index, const QWidget* pButton)
+{
+    return index >= 0 && index < pTabBar->count()
+        && (pTabBar->tabButton(index, QTabBar::LeftSide) == pButton || pTabBar->tabButton(index, QTabBar::RightSide) == pButton);
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Same look as the close buttons QTabBar creates itself, which are private. */
+class GGTabCloseButton : public QAbstractButton
+{
+public:
+    GGTabCloseButton(QWidget* parent)
+        : QAbstractButton(parent)
+    {
+        this->setFocusPolicy(Qt::NoFocus);
+        this->setCursor(Qt::ArrowCursor);
+        this->resize(this->sizeHint());
+    }
+
+    virtual QSize sizeHint() const
+    {
+        this->ensurePolished();
+        int width  = this->style()->pixelMetric(QStyle::PM_TabCloseIndicatorWidth, nullptr, this);
+        int height = this->style()->pixelMetric(QStyle::PM_TabCloseIndicatorHeight, nullptr, this);
+        return QSize(width, height);
+    }
+
+    virtual QSize minimumSizeHint() const { return this->sizeHint(); }
+
+protected:
+    virtual void enterEvent(QEvent* e) { if( this->isEnabled() ) { this->update(); } QAbstractButton::enterEvent(e); }
+    virtual void leaveEvent(QEvent* e) { if( this->isEnabled() ) { this->update(); } QAbstractButton::leaveEvent(e); }
+
+    virtual void paintEvent(QPaintEvent*)
+    {
+        QPainter p(this);
+        QStyleOption opt;
+        opt.initFrom(this);
+        opt.state |= QStyle::State_AutoRaise;
+        if( this->isEnabled() && this->underMouse() && !this->isChecked() && !this->isDown() ) {
+            opt.state |= QStyle::State_Raised;
+        }
+        if( this->isChecked() ) {
+            opt.state |= QStyle::State_On;
+        }
+        if( this->isDown() ) {
+            opt.state |= QStyle::State_Sunken;
+        }
+        this->style()->drawPrimitive(QStyle::PE_IndicatorTabClose, &opt, &p, this);
+    }
+};
+
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Measures texts in a worker thread, chunk by chunk, until no chunk is left. Each text is
+ * written at its own index, so the threads never write to the same width.
+ */
+class GGTabMeasureTask : public QRunnable
+{
+public:
+    GGTabMeasureTask(const QFont& font, const QStringList& texts, int* pWidths, QAtomicInt* pNextChunk, QSemaphore* pDone)
+        : m_font(font)
+        , m_texts(texts)
+        , m_pWidths(pWidths)
+        , m_pNextChunk(pNextChunk)
+        , m_pDone(pDone)
+    {}
+
+    virtual void run()
+    {
+        GGTabMeasureTask::measureChunks(m_font, m_texts, m_pWidths, m_pNextChunk);
+        m_pDone->release(); //The texts, widths and counters may be gone after this.
+    }
+
+    static void measureChunks(const QFont& font, const QStringList& texts, int* pWidths, QAtomicInt* pNextChunk)
+    {
+        QFontMetrics fm(font);
+        for( int chunk = pNextChunk->fetchAndAddRelaxed(1); chunk * GG_TABBAR_MEASURE_CHUNK_SIZE < texts.size();
+             chunk = pNextChunk->fetchAndAddRelaxed(1) ) {
+            int last = qMin(texts.size(), (chunk + 1) * GG_TABBAR_MEASURE_CHUNK_SIZE);
+            for( int i = chunk * GG_TABBAR_MEASURE_CHUNK_SIZE; i < last; ++i ) {
+                pWidths[i] = fm.size(Qt::TextShowMnemonic, texts.at(i)).width();
+            }
+        }
+    }
+
+private:
+    QFont               m_font;
+    const QStringList&  m_texts;
+    int*                m_pWidths;
+    QAtomicInt*         m_pNextChunk;
+    QSemaphore*         m_pDone;
+};
 
 /* ------------------------------------------------------------------------- */
 
 GGTabBar::GGTabBar(QWidget* parent)
     : QTabBar(parent)
     , m_pTabNameEdit(nullptr)
-    , m_iEditedTabIndex(-1)
+    , m_iEditedTabId(0)
     , m_bDragging(false)
     , m_bRenameOnDoubleClick(true)
+    , m_iNextTabId(1)
+    , m_bTabIdInserted(false)
+    , m_bTabIdRemoved(false)
+    , m_bTabIndexesDirty(false)
+    , m_bVirtualized(false)
+    , m_iUniformTabWidth(GG_TABBAR_DEFAULT_UNIFORM_TAB_WIDTH)
+    , m_iUniformTabThickness(-1)
+    , m_iOverscan(GG_TABBAR_DEFAULT_OVERSCAN)
+    , m_iButtonsFirst(0)
+    , m_iButtonsLast(-1)
+    , m_bUpdatingButtons(false)
+    , m_bButtonsRestricted(false)
+    , m_bButtonsSyncPending(false)
+    , m_bTabsClosable(false)
+    , m_iUpdateDepth(0)
+    , m_iUpdateCurrentId(0)
+    , m_bUpdatesWereEnabled(true)
+    , m_sizeHintKey()
+    , m_bMeasuringTab(false)
+    , m_iSizeHintHits(0)
+    , m_iSizeHintMisses(0)
+    , m_bBadgeRelayoutPending(false)
+    , m_iIndicatorRate(GG_TABBAR_DEFAULT_INDICATOR_RATE)
+    , m_pModel(nullptr)
+    , m_iModelColumn(0)
+    , m_bSyncingFromModel(false)
+    , m_bWritingToModel(false)
+    , m_iRemovedRowsFirst(0)
+    , m_bIconCacheConnected(false)
+    , m_bCompactStorage(false)
+    , m_tabPixmapKey()
+    , m_tabPixmaps(GG_TABBAR_DEFAULT_TAB_PIXMAP_BUDGET)
+    , m_bTabPixmapCacheEnabled(false)
+    , m_iTabPixmapHits(0)
+    , m_iTabPixmapMisses(0)
+    , m_bTabDragged(false)
+{
+    m_aModelRoles[TextRole]      = Qt::DisplayRole;
+    m_aModelRoles[IconRole]      = Qt::DecorationRole;
+    m_aModelRoles[ToolTipRole]   = Qt::ToolTipRole;
+    m_aModelRoles[TextColorRole] = Qt::ForegroundRole;
+    m_aModelRoles[DataRole]      = Qt::UserRole;
+
+    this->setTabsClosable(true);
+
+    m_indicatorTimer.setSingleShot(true);
+    m_dragSettleTimer.setSingleShot(true);
+    m_dragSettleTimer.setInterval(GG_TABBAR_DRAG_SETTLE_DELAY);
+
+    connect(this, &QTabBar::tabMoved, this, &GGTabBar::onTabMoved);
+    connect(&m_indicatorTimer, &QTimer::timeout, this, &GGTabBar::flushIndicators);
+    connect(&m_dragSettleTimer, &QTimer::timeout, this, &GGTabBar::onDragSettled);
+}
+
+GGTabBar::~GGTabBar()
+{
+}
+
+int
+GGTabBar::addTab(const QString& text)
+{
+    return this->insertTab(-1, QIcon(), text);
+}
+
+int
+GGTabBar::addTab(const QIcon& icon, const QString& text)
+{
+    return this->insertTab(-1, icon, text);
+}
+
+int
+GGTabBar::insertTab(int index, const QString& text)
+{
+    return this->insertTab(index, QIcon(), text);
+}
+
+/*
+ * The id is inserted before the tab, since QTabBar emits currentChanged for the first tab
+ * before calling tabInserted.
+ */
+int
+GGTabBar::insertTab(int index, const QIcon& icon, const QString& text)
+{
+    if( index < 0 || index > this->count() ) {
+        index = this->count();
+    }
+
+    m_lTabIds.insert(index, m_iNextTabId++);
+    m_bTabIdInserted = true;
+    if( m_bCompactStorage ) {
+        quint32 textHandle = this->internString(text);
+        quint32 iconHandle = this->internIcon(icon);
+        this->insertRecord(index, textHandle, iconHandle);
+        return QTabBar::insertTab(index, iconHandle ? m_iconPool.value(iconHandle) : icon, m_stringPool.value(textHandle));
+    }
+    return QTabBar::insertTab(index, icon, text);
+}
+
+/* Same as insertTab: QTabBar may emit currentChanged before calling tabRemoved. */
+void
+GGTabBar::removeTab(int index)
+{
+    if( index < 0 || index >= this->count() ) { return; }
+
+    emit tabAboutToBeRemoved(index);
+
+    quint64 id = m_lTabIds.at(index);
+    if( id == m_iEditedTabId ) {
+        this->cancelRename();
+    }
+    m_lTabIds.remove(index);
+    this->removeRecord(index);
+    m_bTabIdRemoved = true;
+    m_hashSizeHints.remove(id);
+    m_setPendingCloseButtons.remove(id);
+    m_hashIndicators.remove(id);
+    this->removeIconSource(id);
+    if( !m_bTabIndexesDirty && index == m_lTabIds.size() ) {
+        m_hashTabIndexes.remove(id);
+    } else {
+        m_bTabIndexesDirty = true;
+    }
+
+    QTabBar::removeTab(index);
+}
+
+void
+GGTabBar::setTabText(int index, const QString& text)
+{
+    if( index < 0 || index >= this->count() ) { return; }
+
+    m_hashSizeHints.remove(this->tabId(index));
+    if( m_bCompactStorage ) {
+        quint32 handle = this->internString(text);
+        m_stringPool.release(m_records.texts.at(index));
+        m_records.texts[index] = handle;
+        QTabBar::setTabText(index, m_stringPool.value(handle));
+    } else {
+        QTabBar::setTabText(index, text);
+    }
+    emit tabTextChanged(index);
+}
+
+void
+GGTabBar::setTabIcon(int index, const QIcon& icon)
+{
+    if( index < 0 || index >= this->count() ) { return; }
+
+    this->removeIconSource(this->tabId(index));
+    if( m_bCompactStorage ) {
+        quint32 handle = this->internIcon(icon);
+        m_iconPool.release(m_records.icons.at(index));
+        m_records.icons[index] = handle;
+        QTabBar::setTabIcon(index, handle ? m_iconPool.value(handle) : icon);
+    } else {
+        QTabBar::setTabIcon(index, icon);
+    }
+}
+
+void
+GGTabBar::setIconSize(const QSize& size)
+{
+    QTabBar::setIconSize(size);
+    this->reloadTabIcons();
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* An empty source removes the icon. */
+void
+GGTabBar::setTabIconSource(int index, const QString& source)
+{
+    if( index < 0 || index >= this->count() ) { return; }
+
+    quint64 id = this->tabId(index);
+    this->removeIconSource(id);
+    if( m_bCompactStorage ) {
+        m_iconPool.release(m_records.icons.at(index));
+        m_records.icons[index] = 0;
+    }
+    if( source.isEmpty() ) {
+        QTabBar::setTabIcon(index, QIcon());
+        return;
+    }
+
+    if( !m_bIconCacheConnected ) {
+        m_bIconCacheConnected = true;
+        connect(GGTabIconCache::instance(), &GGTabIconCache::iconReady, this, &GGTabBar::onIconReady);
+    }
+    m_hashIconSources.insert(id, source);
+    m_hashIconSourceTabs.insert(source, id);
+    this->loadTabIcon(index, source);
+}
+
+/* The same icon for all the tabs, so that the tab pixmaps and size hints do not tell them apart. */
+QIcon
+GGTabBar::iconPlaceholder() const
+{
+    if( !m_iconPlaceholder.isNull() ) { return m_iconPlaceholder; }
+
+    if( m_iconStylePlaceholder.isNull() ) {
+        m_iconStylePlaceholder = this->style()->standardIcon(QStyle::SP_FileIcon, nullptr, this);
+    }
+    return m_iconStylePlaceholder;
+}
+
+/* The tabs still showing the previous placeholder are only repainted. */
+void
+GGTabBar::setIconPlaceholder(const QIcon& icon)
+{
+    qint64 previousKey = this->iconPlaceholder().cacheKey();
+    m_iconPlaceholder = icon;
+
+    QIcon placeholder = this->iconPlaceholder();
+    if( placeholder.isNull() ) { return; }
+
+    for( QHash<quint64, QString>::const_iterator it = m_hashIconSources.constBegin(); it != m_hashIconSources.constEnd(); ++it ) {
+        int index = this->tabIndex(it.key());
+        if( index >= 0 && this->tabIcon(index).cacheKey() == previousKey ) {
+            QTabBar::setTabIcon(index, placeholder);
+        }
+    }
+}
+
+/*
+ * A tab keeps its current icon, if any, rather than the placeholder while its new one is decoded.
+ * QTabBar only repaints a tab whose icon is replaced by another one, so only the tabs getting
+ * their first icon are laid out again.
+ */
+void
+GGTabBar::loadTabIcon(int index, const QString& source)
+{
+    GGTabIconCache* pCache = GGTabIconCache::instance();
+    QSize size = this->iconSize();
+    qreal dpr = this->devicePixelRatioF();
+
+    QPixmap pixmap = pCache->pixmap(source, size, dpr);
+    if( !pixmap.isNull() ) {
+        QTabBar::setTabIcon(index, QIcon(pixmap));
+        return;
+    }
+    if( this->tabIcon(index).isNull() ) {
+        QTabBar::setTabIcon(index, this->iconPlaceholder());
+    }
+    pCache->request(source, size, dpr);
+}
+
+void
+GGTabBar::reloadTabIcons()
+{
+    for( QHash<quint64, QString>::const_iterator it = m_hashIconSources.constBegin(); it != m_hashIconSources.constEnd(); ++it ) {
+        int index = this->tabIndex(it.key());
+        if( index >= 0 ) {
+            this->loadTabIcon(index, it.value());
+        }
+    }
+}
+
+void
+GGTabBar::removeIconSource(quint64 id)
+{
+    QHash<quint64, QString>::iterator it = m_hashIconSources.find(id);
+    if( it == m_hashIconSources.end() ) { return; }
+
+    m_hashIconSourceTabs.remove(it.value(), id);
+    m_hashIconSources.erase(it);
+}
+
+/* All the tabs with that source share the same pixmap, which the cache may have evicted already. */
+void
+GGTabBar::onIconReady(const QString& source, const QSize& size, qreal devicePixelRatio, const QPixmap& pixmap)
+{
+    if( size != this->iconSize() || devicePixelRatio != this->devicePixelRatioF() ) { return; }
+
+    QList<quint64> ids = m_hashIconSourceTabs.values(source);
+    if( ids.isEmpty() ) { return; }
+
+    QIcon icon(pixmap);
+
+    for( int i = 0; i < ids.size(); ++i ) {
+        int index = this->tabIndex(ids.at(i));
+        if( index >= 0 ) {
+            QTabBar::setTabIcon(index, icon);
+        }
+    }
+}
+
+bool
+GGTabBar::event(QEvent* e)
+{
+#ifndef QT_NO_WHATSTHIS
+    if( m_bCompactStorage && QEvent::WhatsThis == e->type() ) {
+        QHelpEvent* pHelpEvent = static_cast<QHelpEvent*>(e);
+        QString text = this->tabWhatsThis(this->tabAt(pHelpEvent->pos()));
+        if( !text.isEmpty() ) {
+            QWhatsThis::showText(pHelpEvent->globalPos(), text, this);
+            return true;
+        }
+    }
+#endif
+#ifndef QT_NO_TOOLTIP
+    if( (m_pModel || m_bCompactStorage) && QEvent::ToolTip == e->type() ) {
+        QHelpEvent* pHelpEvent = static_cast<QHelpEvent*>(e);
+        QString tip = this->tabToolTip(this->tabAt(pHelpEvent->pos()));
+        if( tip.isEmpty() ) {
+            QToolTip::hideText();
+            e->ignore();
+        } else {
+            QToolTip::showText(pHelpEvent->globalPos(), tip, this);
+        }
+        return true;
+    }
+#endif
+    return QTabBar::event(e);
+}
+
+/* Escape cancels the rename. */
+bool
+GGTabBar::eventFilter(QObject* o, QEvent* e)
+{
+    if( o == m_pTabNameEdit && QEvent::KeyPress == e->type()
+        && Qt::Key_Escape == static_cast<QKeyEvent*>(e)->key() ) {
+        this->cancelRename();
+        return true;
+    }
+    return QTabBar::eventFilter(o, e);
+}
+
+void
+GGTabBar::tabInserted(int index)
+{
+    if( !m_bTabIdInserted ) {
+        m_lTabIds.insert(index, m_iNextTabId++);
+        this->insertRecord(index, 0, 0);
+    }
+    m_bTabIdInserted = false;
+
+    if( !m_bTabIndexesDirty && index == m_lTabIds.size() - 1 ) {
+        m_hashTabIndexes.insert(m_lTabIds.at(index), index);
+    } else {
+        m_bTabIndexesDirty = true;
+    }
+
+    if( m_bTabsClosable && !m_bVirtualized ) {
+        if( m_iUpdateDepth > 0 ) {
+            m_setPendingCloseButtons.insert(m_lTabIds.at(index));
+        } else {
+            this->setTabButtonsVisible(index, true);
+        }
+    }
+
+    QTabBar::tabInserted(index);
+    emit tabAdded(index);
+}
+
+void
+GGTabBar::tabRemoved(int index)
+{
+    if( !m_bTabIdRemoved ) {
+        m_setPendingCloseButtons.remove(m_lTabIds.at(index));
+        m_lTabIds.remove(index);
+        this->removeRecord(index);
+        m_bTabIndexesDirty = true;
+    }
+    m_bTabIdRemoved = false;
+
+    QTabBar::tabRemoved(index);
+}
+
+void
+GGTabBar::onTabMoved(int from, int to)
+{
+    quint64 id = m_lTabIds.at(from);
+    m_lTabIds.remove(from);
+    m_lTabIds.insert(to, id);
+    m_bTabIndexesDirty = true;
+
+    if( m_bCompactStorage ) {
+        m_records.texts.move(from, to);
+        m_records.icons.move(from, to);
+        m_records.toolTips.move(from, to);
+        m_records.whatsThis.move(from, to);
+        m_records.data.move(from, to);
+    }
+
+    //The tab was dragged or moved through the tab bar: move its row as well.
+    if( m_pModel && !m_bSyncingFromModel && !this->moveModelRow(from, to) ) {
+        QMetaObject::invokeMethod(this, "onModelReset", Qt::QueuedConnection);
+    }
+}
+
+/* Returns -1 if there is no tab with this id. The id-to-index table is only rebuilt when needed. */
+int
+GGTabBar::tabIndex(quint64 id) const
+{
+    if( m_bTabIndexesDirty ) {
+        m_hashTabIndexes.clear();
+        m_hashTabIndexes.reserve(m_lTabIds.size());
+        for( int i = 0; i < m_lTabIds.size(); ++i ) {
+            m_hashTabIndexes.insert(m_lTabIds.at(i), i);
+        }
+        m_bTabIndexesDirty = false;
+    }
+    return m_hashTabIndexes.value(id, -1);
+}
+
+void
+GGTabBar::setVirtualized(bool b)
+{
+    if( b == m_bVirtualized ) { return; }
+
+    m_bVirtualized = b;
+    m_iUniformTabThickness = -1;
+
+    //In virtualized mode, the close buttons are only attached to the visible tabs.
+    if( m_bVirtualized ) {
+        m_setPendingCloseButtons.clear();
+    }
+    this->relayoutTabs();
+    this->updateVisibleTabButtons(true);
+}
+
+void
+GGTabBar::setTabsClosable(bool closable)
+{
+    if( closable == m_bTabsClosable ) { return; }
+
+    m_bTabsClosable = closable;
+    m_setPendingCloseButtons.clear();
+    this->updateVisibleTabButtons(true);
+}
+
+void
+GGTabBar::setUniformTabWidth(int width)
+{
+    width = qMax(1, width);
+    if( width == m_iUniformTabWidth ) { return; }
+
+    m_iUniformTabWidth = width;
+    if( m_bVirtualized ) {
+        this->relayoutTabs();
+    }
+}
+
+void
+GGTabBar::setOverscan(int tabs)
+{
+    m_iOverscan = qMax(0, tabs);
+    if( m_bVirtualized || !m_setPendingCloseButtons.isEmpty() ) {
+        this->updateVisibleTabButtons(false);
+    }
+}
+
+void
+GGTabBar::setViewportRect(const QRect& r)
+{
+    if( r == m_viewportRect ) { return; }
+
+    m_viewportRect = r;
+    if( m_bVirtualized || !m_setPendingCloseButtons.isEmpty() ) {
+        this->updateVisibleTabButtons(false);
+    }
+}
+
+/* Offset of pos along the direction in which the tabs are laid out, growing with the tab index. */
+int
+GGTabBar::axisOffset(const QPoint& pos) const
+{
+    if( _isVerticalShape(this->shape()) ) {
+        return pos.y();
+    }
+    return Qt::RightToLeft == this->layoutDirection() ? this->width() - 1 - pos.x() : pos.x();
+}
+
+/* Tab rects are sorted along the tab axis, so the first tab ending after offset is found by bisection. */
+int
+GGTabBar::tabAtOffset(int offset) const
+{
+    int lo = 0;
+    int hi = this->count();
+
+    while( lo < hi ) {
+        int mid = lo + (hi - lo) / 2;
+        const QRect r = QTabBar::tabRect(mid);
+        int end = qMax(this->axisOffset(r.topLeft()), this->axisOffset(r.bottomRight()));
+        if( end < offset ) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+int
+GGTabBar::firstVisibleTab() const
+{
+    if( 0 == this->count() ) { return -1; }
+
+    const QRect r = this->viewportRect();
+    int first = this->tabAtOffset(qMin(this->axisOffset(r.topLeft()), this->axisOffset(r.bottomRight())));
+    return qBound(0, first - m_iOverscan, this->count() - 1);
+}
+
+int
+GGTabBar::lastVisibleTab() const
+{
+    if( 0 == this->count() ) { return -1; }
+
+    const QRect r = this->viewportRect();
+    int last = this->tabAtOffset(qMax(this->axisOffset(r.topLeft()), this->axisOffset(r.bottomRight())));
+    return qBound(0, last + m_iOverscan, this->count() - 1);
+}
+
+int
+GGTabBar::tabAt(const QPoint& pos) const
+{
+    if( !m_bVirtualized ) {
+        return QTabBar::tabAt(pos);
+    }
+
+    int index = this->tabAtOffset(this->axisOffset(pos));
+    if( index < this->count() && QTabBar::tabRect(index).contains(pos) ) {
+        return index;
+    }
+    return -1;
+}
+
+/* QTabBar lays its tabs out again whenever a tab text is set, even to the same text. */
+void
+GGTabBar::relayoutTabs()
+{
+    GG_TABBAR_PROFILE(Layout);
+    if( 0 == this->count() ) {
+        this->updateGeometry();
+        return;
+    }
+    QTabBar::setTabText(0, QTabBar::tabText(0));
+}
+
+/*
+ * In virtualized mode, the buttons of a tab out of view are hidden, and its close button is
+ * taken back to be recycled. Otherwise a tab keeps its buttons, and one out of view which has
+ * no close button yet waits for it in m_setPendingCloseButtons.
+ */
+void
+GGTabBar::setTabButtonsVisible(int index, bool bVisible)
+{
+    QTabBar::ButtonPosition closeSide = (QTabBar::ButtonPosition)this->style()->styleHint(QStyle::SH_TabBar_CloseButtonPosition, nullptr, this);
+    bool bShown = bVisible || !m_bVirtualized;
+
+    for( int side = QTabBar::LeftSide; side <= QTabBar::RightSide; ++side ) {
+        QTabBar::ButtonPosition position = (QTabBar::ButtonPosition)side;
+        QWidget* pButton = this->tabButton(index, position);
+        if( !pButton ) {
+            continue;
+        }
+        if( !m_setCloseButtons.contains(pButton) ) {
+            pButton->setVisible(bShown);
+        } else if( !bShown || !m_bTabsClosable ) {
+            this->setTabButton(index, position, nullptr); //QTabBar hides the previous button.
+            m_lSpareCloseButtons.append(pButton);
+        }
+    }
+
+    if( !m_bTabsClosable || this->tabButton(index, closeSide) ) { return; }
+    if( !bVisible ) {
+        if( !m_bVirtualized ) {
+            m_setPendingCloseButtons.insert(this->tabId(index));
+        }
+        return;
+    }
+
+    QWidget* pButton = nullptr;
+    if( !m_lSpareCloseButtons.isEmpty() ) {
+        pButton = m_lSpareCloseButtons.takeLast();
+    } else {
+        GGTabCloseButton* pCloseButton = new GGTabCloseButton(this);
+        m_setCloseButtons.insert(pCloseButton);
+        connect(pCloseButton, &QAbstractButton::clicked, this, &GGTabBar::onCloseButtonClicked);
+        connect(pCloseButton, &QObject::destroyed,       this, &GGTabBar::onCloseButtonDestroyed);
+        pButton = pCloseButton;
+    }
+    m_setPendingCloseButtons.remove(this->tabId(index));
+    this->setTabButton(index, closeSide, pButton);
+}
+
+/*
+ * Tab buttons are real widgets, and QTabBar relayouts all the tabs whenever one is set, so
+ * close buttons are only attached to the tabs in view. In virtualized mode, they are recycled
+ * between the visible tabs, and when scrolling, only the tabs entering or leaving the range are
+ * touched. Otherwise, only the tabs still waiting for their close button are visited.
+ */
+void
+GGTabBar::updateVisibleTabButtons(bool bFull)
+{
+    m_bButtonsSyncPending = false;
+    if( m_bUpdatingButtons || m_iUpdateDepth > 0 ) { return; }
+    bFull = bFull || m_bButtonsRestricted != m_bVirtualized;
+    if( !m_bVirtualized && !bFull && m_setPendingCloseButtons.isEmpty() ) { return; }
+    m_bUpdatingButtons = true;
+
+    int first = this->firstVisibleTab();
+    int last  = this->lastVisibleTab();
+
+    if( bFull || (m_bVirtualized && (first > m_iButtonsLast || last < m_iButtonsFirst)) ) {
+        for( int i = 0; i < this->count(); ++i ) {
+            this->setTabButtonsVisible(i, i >= first && i <= last);
+        }
+    } else if( m_bVirtualized ) {
+        for( int i = m_iButtonsFirst; i < first; ++i )   { this->setTabButtonsVisible(i, false); }
+        for( int i = last + 1; i <= m_iButtonsLast; ++i ) { this->setTabButtonsVisible(i, false); }
+        for( int i = first; i < m_iButtonsFirst; ++i )   { this->setTabButtonsVisible(i, true); }
+        for( int i = m_iButtonsLast + 1; i <= last; ++i ) { this->setTabButtonsVisible(i, true); }
+    } else {
+        for( int i = first; i <= last && i >= 0 && !m_setPendingCloseButtons.isEmpty(); ++i ) {
+            if( m_setPendingCloseButtons.contains(this->tabId(i)) ) {
+                this->setTabButtonsVisible(i, true);
+            }
+        }
+    }
+
+    m_iButtonsFirst = first;
+    m_iButtonsLast  = last;
+    m_bButtonsRestricted = m_bVirtualized;
+    m_bUpdatingButtons = false;
+}
+
+/* The button lies on its tab, unless the tab is being moved. */
+void
+GGTabBar::onCloseButtonClicked()
+{
+    QWidget* pButton = qobject_cast<QWidget*>(this->sender());
+    int index = this->tabAt(pButton->geometry().center());
+    if( _hasTabButton(this, index, pButton) ) {
+        emit tabCloseRequested(index);
+        return;
+    }
+    for( int i = 0; i < this->count(); ++i ) {
+        if( _hasTabButton(this, i, pButton) ) {
+            emit tabCloseRequested(i);
+            return;
+        }
+    }
+}
+
+void
+GGTabBar::onCloseButtonDestroyed(QObject* pButton)
+{
+    m_setCloseButtons.remove(pButton);
+    m_lSpareCloseButtons.removeOne(static_cast<QWidget*>(pButton));
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*
+ * QTabBar still lays the tabs out on each change, but the painting, the close buttons and the
+ * height and scroll offset of the scroll area wait for the end of the update, which lays the
+ * tabs out once more. The tabs inserted meanwhile get their close button once in view
+ * (see updateVisibleTabButtons()), since setting a tab button lays the tabs out.
+ */
+void
+GGTabBar::beginUpdate()
+{
+    if( 0 < m_iUpdateDepth++ ) { return; }
+
+    m_bUpdatesWereEnabled = this->updatesEnabled();
+    this->setUpdatesEnabled(false);
+    m_iUpdateCurrentId = this->tabId(this->currentIndex());
+    emit updateStarted();
+}
+
+void
+GGTabBar::endUpdate()
+{
+    Q_ASSERT(m_iUpdateDepth > 0);
+    if( 0 < --m_iUpdateDepth ) { return; }
+
+    this->relayoutTabs();
+    this->setUpdatesEnabled(m_bUpdatesWereEnabled);
+    this->updateVisibleTabButtons(m_bVirtualized);
+    emit tabsChanged();
+    if( this->tabId(this->currentIndex()) != m_iUpdateCurrentId ) {
+        emit currentChanged(this->currentIndex());
+    }
+}
+
+int
+GGTabBar::addTabs(const QStringList& texts)
+{
+    return this->insertTabs(this->count(), texts);
+}
+
+/* Returns the index of the first inserted tab. */
+int
+GGTabBar::insertTabs(int index, const QStringList& texts)
+{
+    if( index < 0 || index > this->count() ) {
+        index = this->count();
+    }
+
+    this->measureTexts(texts);
+    this->beginUpdate();
+    for( int i = 0; i < texts.size(); ++i ) {
+        this->insertTab(index + i, texts.at(i));
+    }
+    this->endUpdate();
+
+    return index;
+}
+
+void
+GGTabBar::removeTabs(int index, int count)
+{
+    int last = qMin(index + count, this->count()) - 1;
+    index = qMax(0, index);
+
+    //From the end, so that QTabBar does not shift the remaining tabs at each removal.
+    this->beginUpdate();
+    for( int i = last; i >= index; --i ) {
+        this->removeTab(i);
+    }
+    this->endUpdate();
+}
+
+/*
+ * All the texts are validated before any tab is renamed, then the tabs are renamed in a single
+ * batch. Returns false, without renaming any tab, if a text is rejected or a tab does not exist.
+ * A model may still refuse a text in setData(): the texts it had already accepted are restored.
+ */
+bool
+GGTabBar::renameTabs(const QHash<quint64, QString>& texts)
+{
+    QVector<QPair<int, QString> > lRenames;
+    lRenames.reserve(texts.size());
+    for( QHash<quint64, QString>::const_iterator it = texts.constBegin(); it != texts.constEnd(); ++it ) {
+        int index = this->tabIndex(it.key());
+        QString text = it.value();
+        if( index < 0 || (m_renameValidator && !m_renameValidator(index, text)) ) { return false; }
+        lRenames.append(qMakePair(index, text));
+    }
+
+    //Persistent indexes: a sorting model may move its rows as they are renamed.
+    QVector<QPersistentModelIndex> lModelIndexes;
+    if( m_pModel ) {
+        lModelIndexes.reserve(lRenames.size());
+        for( int i = 0; i < lRenames.size(); ++i ) {
+            lModelIndexes.append(m_pModel->index(lRenames.at(i).first, m_iModelColumn));
+        }
+    }
+
+    bool bAccepted = true;
+    QVector<QPair<QPersistentModelIndex, QVariant> > lApplied;
+
+    this->beginUpdate();
+    for( int i = 0; i < lRenames.size() && bAccepted; ++i ) {
+        int index = m_pModel ? lModelIndexes.at(i).row() : lRenames.at(i).first;
+        if( index == this->renamedTab() ) {
+            this->cancelRename();
+        }
+        if( m_pModel ) {
+            QVariant previous = m_pModel->data(lModelIndexes.at(i), m_aModelRoles[TextRole]);
+            bAccepted = m_pModel->setData(lModelIndexes.at(i), lRenames.at(i).second, m_aModelRoles[TextRole]);
+            if( bAccepted ) {
+                lApplied.append(qMakePair(lModelIndexes.at(i), previous));
+            }
+        } else if( lRenames.at(i).second != this->tabText(index) ) {
+            this->setTabText(index, lRenames.at(i).second);
+        }
+    }
+    for( int i = lApplied.size() - 1; !bAccepted && i >= 0; --i ) {
+        m_pModel->setData(lApplied.at(i).first, lApplied.at(i).second, m_aModelRoles[TextRole]);
+    }
+    this->endUpdate();
+
+    return bAccepted;
+}
+
+/* Removes the tabs whose index satisfies predicate and returns how many were removed. */
+int
+GGTabBar::removeIf(const std::function<bool(int)>& predicate)
+{
+    int removed = 0;
+
+    this->beginUpdate();
+    for( int i = this->count() - 1; i >= 0; --i ) {
+        if( predicate(i) ) {
+            this->removeTab(i);
+            ++removed;
+        }
+    }
+    this->endUpdate();
+
+    return removed;
+}
+
+/* -1 hides the progress. */
+void
+GGTabBar::setTabProgress(int index, int value)
+{
+    quint64 id = this->tabId(index);
+    if( 0 == id ) { return; }
+
+    value = value < 0 ? -1 : qMin(value, 100);
+    if( m_hashIndicators.value(id).progress == value ) { return; }
+
+    TabIndicators& indicators = m_hashIndicators[id];
+    indicators.progress = value;
+    if( indicators.progress < 0 && indicators.badge <= 0 ) {
+        m_hashIndicators.remove(id);
+    }
+    this->scheduleIndicatorUpdate(id);
+}
+
+int
+GGTabBar::tabProgress(int index) const
+{
+    return m_hashIndicators.value(this->tabId(index)).progress;
+}
+
+/*
+ * 0 hides the badge. The tabs are only laid out again when the width of the badge changes,
+ * since the tab reserves room for it, and then once per flushIndicators().
+ */
+void
+GGTabBar::setTabBadge(int index, int count)
+{
+    quint64 id = this->tabId(index);
+    if( 0 == id ) { return; }
+
+    count = qMax(0, count);
+    if( m_hashIndicators.value(id).badge == count ) { return; }
+
+    TabIndicators& indicators = m_hashIndicators[id];
+    int oldWidth = indicators.badge > 0 ? this->badgeWidth(indicators.badge) : 0;
+    int newWidth = count > 0 ? this->badgeWidth(count) : 0;
+    indicators.badge = count;
+    if( indicators.progress < 0 && indicators.badge <= 0 ) {
+        m_hashIndicators.remove(id);
+    }
+
+    if( oldWidth != newWidth && !m_bVirtualized ) {
+        m_bBadgeRelayoutPending = true;
+    }
+    this->scheduleIndicatorUpdate(id);
+}
+
+int
+GGTabBar::tabBadge(int index) const
+{
+    return m_hashIndicators.value(this->tabId(index)).badge;
+}
+
+void
+GGTabBar::setIndicatorRate(int hz)
+{
+    m_iIndicatorRate = qMax(1, hz);
+}
+
+int
+GGTabBar::badgeWidth(int count) const
+{
+    const QFontMetrics& fm = this->fontMetrics();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    int textWidth = fm.horizontalAdvance(_badgeText(count));
+#else
+    int textWidth = fm.width(_badgeText(count));
+#endif
+    return qMax(fm.height(), textWidth + fm.height() / 2);
+}
+
+/* Repaints the changed tabs at most indicatorRate() times per second. */
+void
+GGTabBar::scheduleIndicatorUpdate(quint64 id)
+{
+    m_setDirtyIndicators.insert(id);
+    if( m_indicatorTimer.isActive() ) { return; }
+
+    int interval = 1000 / m_iIndicatorRate;
+    qint64 elapsed = m_lastIndicatorFlush.isValid() ? m_lastIndicatorFlush.elapsed() : interval;
+    m_indicatorTimer.start(int(qMax<qint64>(0, interval - elapsed)));
+}
+
+void
+GGTabBar::flushIndicators()
+{
+    m_lastIndicatorFlush.start();
+    if( m_bBadgeRelayoutPending ) {
+        m_bBadgeRelayoutPending = false;
+        m_setDirtyIndicators.clear();
+        this->relayoutTabs(); //Repaints the whole tab bar.
+        return;
+    }
+    for( QSet<quint64>::const_iterator it = m_setDirtyIndicators.constBegin(); it != m_setDirtyIndicators.constEnd(); ++it ) {
+        int index = this->tabIndex(*it);
+        if( index >= 0 ) {
+            this->update(this->tabRect(index));
+        }
+    }
+    m_setDirtyIndicators.clear();
+}
+
+/* Replaces the tabs by the rows of the given column of pModel, or removes them all if pModel is null. */
+void
+GGTabBar::setModel(QAbstractItemModel* pModel, int column)
+{
+    if( m_pModel ) {
+        disconnect(m_pModel, nullptr, this, nullptr);
+    }
+
+    m_pModel = pModel;
+    m_iModelColumn = column;
+
+    if( m_pModel ) {
+        connect(m_pModel, &QAbstractItemModel::rowsInserted,          this, &GGTabBar::onModelRowsInserted);
+        connect(m_pModel, &QAbstractItemModel::rowsAboutToBeRemoved,  this, &GGTabBar::onModelRowsAboutToBeRemoved);
+        connect(m_pModel, &QAbstractItemModel::rowsRemoved,           this, &GGTabBar::onModelRowsRemoved);
+        connect(m_pModel, &QAbstractItemModel::rowsMoved,             this, &GGTabBar::onModelRowsMoved);
+        connect(m_pModel, &QAbstractItemModel::dataChanged,           this, &GGTabBar::onModelDataChanged);
+        connect(m_pModel, &QAbstractItemModel::modelReset,            this, &GGTabBar::onModelReset);
+        connect(m_pModel, &QAbstractItemModel::layoutChanged,         this, &GGTabBar::onModelReset);
+        connect(m_pModel, &QObject::destroyed,                        this, &GGTabBar::onModelDestroyed);
+    }
+
+    this->onModelReset();
+}
+
+void
+GGTabBar::setRoleMapping(TabRole role, int itemRole)
+{
+    if( role < 0 || role >= TabRoleCount || m_aModelRoles[role] == itemRole ) { return; }
+
+    m_aModelRoles[role] = itemRole;
+    if( m_pModel && (TextRole == role || IconRole == role || TextColorRole == role) ) {
+        this->beginUpdate();
+        for( int i = 0; i < this->count(); ++i ) {
+            this->updateTabFromModel(i, TextRole == role, IconRole == role, TextColorRole == role);
+        }
+        this->endUpdate();
+    }
+}
+
+void
+GGTabBar::setTabData(int index, const QVariant& data)
+{
+    if( index < 0 || index >= this->count() ) { return; }
+
+    if( m_pModel ) {
+        m_pModel->setData(m_pModel->index(index, m_iModelColumn), data, m_aModelRoles[DataRole]);
+        return;
+    }
+    if( m_bCompactStorage ) {
+        quint32 handle = QVariant::String == data.type() ? this->internString(data.toString()) : 0;
+        m_stringPool.release(m_records.data.at(index));
+        m_records.data[index] = handle;
+        if( handle ) {
+            QTabBar::setTabData(index, m_stringPool.value(handle));
+            return;
+        }
+    }
+    QTabBar::setTabData(index, data);
+}
+
+QVariant
+GGTabBar::tabData(int index) const
+{
+    if( !m_pModel ) {
+        return QTabBar::tabData(index);
+    }
+    return this->modelData(index, DataRole);
+}
+
+#ifndef QT_NO_TOOLTIP
+void
+GGTabBar::setTabToolTip(int index, const QString& tip)
+{
+    if( index < 0 || index >= this->count() ) { return; }
+
+    if( m_pModel ) {
+        m_pModel->setData(m_pModel->index(index, m_iModelColumn), tip, m_aModelRoles[ToolTipRole]);
+        return;
+    }
+    if( !m_bCompactStorage ) {
+        QTabBar::setTabToolTip(index, tip);
+        return;
+    }
+    quint32 handle = this->internString(tip);
+    m_stringPool.release(m_records.toolTips.at(index));
+    m_records.toolTips[index] = handle;
+}
+
+QString
+GGTabBar::tabToolTip(int index) const
+{
+    if( m_pModel ) {
+        return this->modelData(index, ToolTipRole).toString();
+    }
+    if( m_bCompactStorage ) {
+        return index >= 0 && index < this->count() ? m_stringPool.value(m_records.toolTips.at(index)) : QString();
+    }
+    return QTabBar::tabToolTip(index);
+}
+#endif
+
+#ifndef QT_NO_WHATSTHIS
+void
+GGTabBar::setTabWhatsThis(int index, const QString& text)
+{
+    if( index < 0 || index >= this->count() ) { return; }
+
+    if( !m_bCompactStorage ) {
+        QTabBar::setTabWhatsThis(index, text);
+        return;
+    }
+    quint32 handle = this->internString(text);
+    m_stringPool.release(m_records.whatsThis.at(index));
+    m_records.whatsThis[index] = handle;
+}
+
+QString
+GGTabBar::tabWhatsThis(int index) const
+{
+    if( m_bCompactStorage ) {
+        return index >= 0 && index < this->count() ? m_stringPool.value(m_records.whatsThis.at(index)) : QString();
+    }
+    return QTabBar::tabWhatsThis(index);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+/*
+ * The strings already given to QTabBar are replaced by the interned ones, and the tool tips and
+ * what's this are moved out of it, or back into it. The tabs are laid out once.
+ */
+void
+GGTabBar::setCompactStorage(bool b)
 {
-    this->setTabsClosable(true);
+    if( b == m_bCompactStorage ) { return; }
+
+    this->beginUpdate();
+    if( b ) {
+        m_bCompactStorage = true;
+        int count = this->count();
+        m_records.texts.fill(0, count);
+        m_records.icons.fill(0, count);
+        m_records.toolTips.fill(0, count);
+        m_records.whatsThis.fill(0, count);
+        m_records.data.fill(0, count);
+        for( int i = 0; i < count; ++i ) {
+            m_records.texts[i] = this->internString(QTabBar::tabText(i));
+            if( m_records.texts.at(i) ) {
+                QTabBar::setTabText(i, m_stringPool.value(m_records.texts.at(i)));
+            }
+            if( !m_hashIconSources.contains(this->tabId(i)) ) {
+                m_records.icons[i] = this->internIcon(QTabBar::tabIcon(i));
+                if( m_records.icons.at(i) ) {
+                    QTabBar::setTabIcon(i, m_iconPool.value(m_records.icons.at(i)));
+                }
+            }
+            QVariant data = QTabBar::tabData(i);
+            if( QVariant::String == data.type() ) {
+                m_records.data[i] = this->internString(data.toString());
+                QTabBar::setTabData(i, m_stringPool.value(m_records.data.at(i)));
+            }
+#ifndef QT_NO_TOOLTIP
+            m_records.toolTips[i] = this->internString(QTabBar::tabToolTip(i));
+            QTabBar::setTabToolTip(i, QString());
+#endif
+#ifndef QT_NO_WHATSTHIS
+            m_records.whatsThis[i] = this->internString(QTabBar::tabWhatsThis(i));
+            QTabBar::setTabWhatsThis(i, QString());
+#endif
+        }
+    } else {
+        for( int i = 0; i < this->count(); ++i ) {
+#ifndef QT_NO_TOOLTIP
+            QTabBar::setTabToolTip(i, m_stringPool.value(m_records.toolTips.at(i)));
+#endif
+#ifndef QT_NO_WHATSTHIS
+            QTabBar::setTabWhatsThis(i, m_stringPool.value(m_records.whatsThis.at(i)));
+#endif
+        }
+        m_records = TabRecords();
+        m_stringPool.clear();
+        m_iconPool.clear();
+        m_bCompactStorage = false;
+    }
+    this->endUpdate();
 }
 
-GGTabBar::~GGTabBar()
+/*
+ * Characters of the strings, and in compact storage the handle arrays, each interned string
+ * being counted once. Neither the bookkeeping of QTabBar and of the pools nor the icons, whose
+ * pixmaps are shared with QIcon's own cache, are counted: the benchmark measures the actual
+ * saving from the resident memory.
+ */
+qint64
+GGTabBar::tabMetadataBytes() const
+{
+    if( m_bCompactStorage ) {
+        return m_stringPool.bytes()
+             + qint64(m_records.texts.capacity() + m_records.icons.capacity() + m_records.toolTips.capacity()
+                      + m_records.whatsThis.capacity() + m_records.data.capacity()) * qint64(sizeof(quint32));
+    }
+
+    qint64 bytes = 0;
+    for( int i = 0; i < this->count(); ++i ) {
+        bytes += _stringBytes(QTabBar::tabText(i));
+        QVariant data = QTabBar::tabData(i);
+        if( QVariant::String == data.type() ) {
+            bytes += _stringBytes(data.toString());
+        }
+#ifndef QT_NO_TOOLTIP
+        bytes += _stringBytes(QTabBar::tabToolTip(i));
+#endif
+#ifndef QT_NO_WHATSTHIS
+        bytes += _stringBytes(QTabBar::tabWhatsThis(i));
+#endif
+    }
+    return bytes;
+}
+
+quint32
+GGTabBar::internString(const QString& string)
+{
+    return string.isEmpty() ? 0 : m_stringPool.intern(string, string, int(_stringBytes(string)));
+}
+
+/* Only theme icons can be recognized: other icons are kept as given, and not interned. */
+quint32
+GGTabBar::internIcon(const QIcon& icon)
+{
+    return icon.isNull() || icon.name().isEmpty() ? 0 : m_iconPool.intern(icon.name(), icon);
+}
+
+void
+GGTabBar::insertRecord(int index, quint32 text, quint32 icon)
+{
+    if( !m_bCompactStorage ) { return; }
+
+    m_records.texts.insert(index, text);
+    m_records.icons.insert(index, icon);
+    m_records.toolTips.insert(index, 0);
+    m_records.whatsThis.insert(index, 0);
+    m_records.data.insert(index, 0);
+}
+
+void
+GGTabBar::removeRecord(int index)
+{
+    if( !m_bCompactStorage ) { return; }
+
+    m_stringPool.release(m_records.texts.at(index));
+    m_iconPool.release(m_records.icons.at(index));
+    m_stringPool.release(m_records.toolTips.at(index));
+    m_stringPool.release(m_records.whatsThis.at(index));
+    m_stringPool.release(m_records.data.at(index));
+    m_records.texts.remove(index);
+    m_records.icons.remove(index);
+    m_records.toolTips.remove(index);
+    m_records.whatsThis.remove(index);
+    m_records.data.remove(index);
+}
+
+/* Inserts the tabs of the rows first to last, which the model has just inserted. */
+void
+GGTabBar::insertModelTabs(int first, int last)
+{
+    bool bBatch = last > first;
+    if( bBatch ) {
+        this->beginUpdate();
+    }
+    for( int row = first; row <= last; ++row ) {
+        QModelIndex index = m_pModel->index(row, m_iModelColumn);
+        this->insertTab(row, qvariant_cast<QIcon>(index.data(m_aModelRoles[IconRole])), index.data(m_aModelRoles[TextRole]).toString());
+        QColor color = _variantColor(index.data(m_aModelRoles[TextColorRole]));
+        if( color.isValid() ) {
+            this->setTabTextColor(row, color);
+        }
+    }
+    if( bBatch ) {
+        this->endUpdate();
+    }
+}
+
+void
+GGTabBar::updateTabFromModel(int index, bool bText, bool bIcon, bool bTextColor)
+{
+    QModelIndex modelIndex = m_pModel->index(index, m_iModelColumn);
+    if( bText ) {
+        QString text = modelIndex.data(m_aModelRoles[TextRole]).toString();
+        if( text != this->tabText(index) ) {
+            this->setTabText(index, text);
+        }
+    }
+    if( bIcon ) {
+        this->setTabIcon(index, qvariant_cast<QIcon>(modelIndex.data(m_aModelRoles[IconRole])));
+    }
+    if( bTextColor ) {
+        this->setTabTextColor(index, _variantColor(modelIndex.data(m_aModelRoles[TextColorRole])));
+    }
+}
+
+void
+GGTabBar::onModelRowsInserted(const QModelIndex& parent, int first, int last)
+{
+    if( parent.isValid() || m_bWritingToModel ) { return; }
+
+    m_bSyncingFromModel = true;
+    this->insertModelTabs(first, last);
+    m_bSyncingFromModel = false;
+}
+
+/*
+ * Tab data of the tab at index. While the tabs of removed rows are being removed, they are read
+ * from the values kept before the removal, and the tabs after them are offset from their rows.
+ */
+QVariant
+GGTabBar::modelData(int index, TabRole role) const
+{
+    int pending = this->count() - m_pModel->rowCount();
+    if( pending > 0 && !m_lRemovedRowsData.isEmpty() && index >= m_iRemovedRowsFirst ) {
+        if( index < m_iRemovedRowsFirst + pending ) {
+            //The tabs are removed from the last one.
+            int i = index - m_iRemovedRowsFirst;
+            return ToolTipRole == role ? QVariant(m_lRemovedRowsToolTips.at(i)) : m_lRemovedRowsData.at(i);
+        }
+        index -= pending;
+    }
+    return m_pModel->index(index, m_iModelColumn).data(m_aModelRoles[role]);
+}
+
+/*
+ * Moves the row from before to, as the tab was. Without moveRows(), the row is inserted again
+ * with the item data of its columns, then the original row is removed.
+ */
+bool
+GGTabBar::moveModelRow(int from, int to)
+{
+    int destination = to > from ? to + 1 : to;
+
+    m_bWritingToModel = true;
+    bool bMoved = m_pModel->moveRow(QModelIndex(), from, QModelIndex(), destination);
+    if( !bMoved && m_pModel->insertRow(destination) ) {
+        int source = destination > from ? from : from + 1;
+        for( int c = 0; c < m_pModel->columnCount(); ++c ) {
+            m_pModel->setItemData(m_pModel->index(destination, c), m_pModel->itemData(m_pModel->index(source, c)));
+        }
+        bMoved = m_pModel->removeRow(source);
+        if( !bMoved ) {
+            m_pModel->removeRow(destination);
+        }
+    }
+    m_bWritingToModel = false;
+    return bMoved;
+}
+
+/* The tabs are removed once the rows are, so that the tab indexes match the rows meanwhile. */
+void
+GGTabBar::onModelRowsAboutToBeRemoved(const QModelIndex& parent, int first, int last)
+{
+    if( parent.isValid() || m_bWritingToModel ) { return; }
+
+    m_iRemovedRowsFirst = first;
+    m_lRemovedRowsData.clear();
+    m_lRemovedRowsToolTips.clear();
+    for( int row = first; row <= last; ++row ) {
+        QModelIndex index = m_pModel->index(row, m_iModelColumn);
+        m_lRemovedRowsData.append(index.data(m_aModelRoles[DataRole]));
+        m_lRemovedRowsToolTips.append(index.data(m_aModelRoles[ToolTipRole]).toString());
+    }
+}
+
+void
+GGTabBar::onModelRowsRemoved(const QModelIndex& parent, int first, int last)
+{
+    if( parent.isValid() || m_bWritingToModel ) { return; }
+
+    m_bSyncingFromModel = true;
+    if( last > first ) {
+        this->removeTabs(first, last - first + 1);
+    } else {
+        this->removeTab(first);
+    }
+    m_bSyncingFromModel = false;
+
+    m_lRemovedRowsData.clear();
+    m_lRemovedRowsToolTips.clear();
+}
+
+/* Rows start to end are moved before row, which is expressed in the indexes from before the move. */
+void
+GGTabBar::onModelRowsMoved(const QModelIndex& parent, int start, int end, const QModelIndex& destination, int row)
+{
+    if( m_bWritingToModel ) { return; }
+    if( parent.isValid() || destination.isValid() ) {
+        //Rows moved from or to another level of a tree model.
+        if( parent != destination ) {
+            this->onModelReset();
+        }
+        return;
+    }
+
+    int count = end - start + 1;
+    m_bSyncingFromModel = true;
+    if( count > 1 ) {
+        this->beginUpdate();
+    }
+    for( int i = 0; i < count; ++i ) {
+        if( row > end ) {
+            this->moveTab(start, row - 1);
+        } else {
+            this->moveTab(start + i, row + i);
+        }
+    }
+    if( count > 1 ) {
+        this->endUpdate();
+    }
+    m_bSyncingFromModel = false;
+}
+
+/* Only the text, icon and color are copied into the tabs: tooltips and data are read when needed. */
+void
+GGTabBar::onModelDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles)
+{
+    if( m_bWritingToModel || topLeft.parent().isValid() || m_iModelColumn < topLeft.column() || m_iModelColumn > bottomRight.column() ) {
+        return;
+    }
+
+    bool bText      = roles.isEmpty() || roles.contains(m_aModelRoles[TextRole]);
+    bool bIcon      = roles.isEmpty() || roles.contains(m_aModelRoles[IconRole]);
+    bool bTextColor = roles.isEmpty() || roles.contains(m_aModelRoles[TextColorRole]);
+    if( !bText && !bIcon && !bTextColor ) { return; }
+
+    int last = qMin(bottomRight.row(), this->count() - 1);
+    bool bBatch = last > topLeft.row();
+    if( bBatch ) {
+        this->beginUpdate();
+    }
+    for( int i = topLeft.row(); i <= last; ++i ) {
+        this->updateTabFromModel(i, bText, bIcon, bTextColor);
+    }
+    if( bBatch ) {
+        this->endUpdate();
+    }
+}
+
+void
+GGTabBar::onModelReset()
+{
+    m_bSyncingFromModel = true;
+    this->beginUpdate();
+    this->removeTabs(0, this->count());
+    if( m_pModel ) {
+        this->insertModelTabs(0, m_pModel->rowCount() - 1);
+    }
+    this->endUpdate();
+    m_bSyncingFromModel = false;
+}
+
+void
+GGTabBar::onModelDestroyed()
+{
+    m_pModel = nullptr;
+    this->onModelReset();
+}
+
+QSize
+GGTabBar::tabSizeHint(int index) const
+{
+    GG_TABBAR_PROFILE_COUNT(TabSizeHint);
+    if( !m_bVirtualized ) {
+        QSize hint = this->reserveCloseButton(index, this->cachedTabSizeHint(index, false));
+        if( !m_hashIndicators.isEmpty() ) {
+            int badge = m_hashIndicators.value(this->tabId(index)).badge;
+            if( badge > 0 ) {
+                hint.rwidth() += this->badgeWidth(badge);
+            }
+        }
+        return hint;
+    }
+
+    bool bVertical = _isVerticalShape(this->shape());
+    if( m_iUniformTabThickness < 0 ) {
+        QSize hint = QTabBar::tabSizeHint(index);
+        m_iUniformTabThickness = bVertical ? hint.width() : hint.height();
+    }
+    return bVertical ? QSize(m_iUniformTabThickness, m_iUniformTabWidth)
+                     : QSize(m_iUniformTabWidth, m_iUniformTabThickness);
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+QSize
+GGTabBar::minimumTabSizeHint(int index) const
+{
+    if( m_bVirtualized ) {
+        return this->tabSizeHint(index);
+    }
+    return this->cachedTabSizeHint(index, true);
+}
+#endif
+
+/*
+ * A tab waiting for its close button is sized as if it had it, so that attaching it does not move
+ * the tabs. QTabBar makes room for the size of a tab button, plus a padding of 4 pixels.
+ * QTabBar::minimumTabSizeHint() calls tabSizeHint(), so the minimum hints include that room too.
+ */
+QSize
+GGTabBar::reserveCloseButton(int index, QSize hint) const
+{
+    if( m_setPendingCloseButtons.isEmpty() || !m_setPendingCloseButtons.contains(this->tabId(index)) ) {
+        return hint;
+    }
+
+    int room = this->style()->pixelMetric(QStyle::PM_TabCloseIndicatorWidth, nullptr, this) + 4;
+    if( _isVerticalShape(this->shape()) ) {
+        hint.rheight() += room;
+    } else {
+        hint.rwidth() += room;
+    }
+    return hint;
+}
+
+void
+GGTabBar::clearSizeHintCache()
+{
+    m_hashSizeHints.clear();
+    m_hashTextWidths.clear();
+    m_hashTabHintModels.clear();
+}
+
+/* Clears the size hints if a setting they depend on has changed since they were measured. */
+void
+GGTabBar::checkSizeHintKey() const
+{
+    SizeHintKey key;
+    key.iconSize = this->iconSize();
+    key.pStyle = this->style();
+    key.devicePixelRatio = this->devicePixelRatioF();
+    key.elideMode = this->elideMode();
+    key.shape = this->shape();
+    key.bDocumentMode = this->documentMode();
+    key.bTabsClosable = m_bTabsClosable;
+    if( !(key == m_sizeHintKey) ) {
+        m_hashSizeHints.clear();
+        m_hashTextWidths.clear();
+        m_hashTabHintModels.clear();
+        m_sizeHintKey = key;
+    }
+}
+
+/*
+ * Measures the texts, and the elided texts measured for the minimum size hints, on the
+ * thread pool, with the GUI thread taking its share of the chunks. Workers are only used if
+ * they are free right away, so the GUI thread never waits for tasks queued behind others.
+ */
+void
+GGTabBar::measureTexts(const QStringList& texts)
+{
+    if( m_bVirtualized || texts.size() < GG_TABBAR_PARALLEL_MEASURE_MIN_TABS ) { return; }
+
+    GG_TABBAR_PROFILE(MeasureTexts);
+    this->checkSizeHintKey();
+
+    QStringList lTexts;
+    lTexts.reserve(2 * texts.size());
+    for( int i = 0; i < texts.size(); ++i ) {
+        const QString& text = texts.at(i);
+        if( !m_hashTextWidths.contains(text) ) {
+            lTexts.append(text);
+        }
+        QString elided = _minimumElidedText(this->elideMode(), text);
+        if( elided != text && !m_hashTextWidths.contains(elided) ) {
+            lTexts.append(elided);
+        }
+    }
+    if( lTexts.isEmpty() ) { return; }
+
+    QVector<int> widths(lTexts.size());
+    QAtomicInt nextChunk(0);
+    QSemaphore done;
+    int chunks = (lTexts.size() + GG_TABBAR_MEASURE_CHUNK_SIZE - 1) / GG_TABBAR_MEASURE_CHUNK_SIZE;
+    int tasks = 0;
+    for( int i = 1; i < chunks && i < QThreadPool::globalInstance()->maxThreadCount(); ++i ) {
+        GGTabMeasureTask* pTask = new GGTabMeasureTask(this->font(), lTexts, widths.data(), &nextChunk, &done);
+        if( !QThreadPool::globalInstance()->tryStart(pTask) ) {
+            delete pTask;
+            break;
+        }
+        ++tasks;
+    }
+    GGTabMeasureTask::measureChunks(this->font(), lTexts, widths.data(), &nextChunk);
+    done.acquire(tasks);
+
+    //Widths of removed tabs are kept until the cache outgrows the tabs.
+    if( m_hashTextWidths.size() > 4 * (this->count() + texts.size()) ) {
+        m_hashTextWidths.clear();
+    }
+    for( int i = 0; i < lTexts.size(); ++i ) {
+        m_hashTextWidths.insert(lTexts.at(i), widths.at(i));
+    }
+}
+
+/* Tabs with the same icon presence and buttons are sized alike, whatever their text. */
+quint64
+GGTabBar::tabHintConfig(int index) const
+{
+    quint64 config = this->tabIcon(index).isNull() ? 0 : 1;
+    const QWidget* aButtons[2] = { this->tabButton(index, QTabBar::LeftSide), this->tabButton(index, QTabBar::RightSide) };
+    for( int i = 0; i < 2; ++i ) {
+        QSize size = aButtons[i] ? aButtons[i]->sizeHint().boundedTo(QSize(0xfff, 0xfff)) : QSize(0, 0);
+        config = (config << 24) | quint64(qMax(0, size.width()) << 12) | quint64(qMax(0, size.height()));
+    }
+    return config;
+}
+
+/*
+ * QTabBar sizes a tab from the width of its text plus margins which depend on its icon,
+ * buttons and the style. So once two tabs of the same configuration have been measured by
+ * QTabBar and their hints matched that model, the hints of the next ones are deduced from the
+ * widths measured by measureTexts(), without shaping their text on the GUI thread. A style
+ * whose hints do not follow the model is detected by the second tab, and then always asked.
+ * text is the text of the tab, elided while QTabBar measures its minimum size hint.
+ */
+QSize
+GGTabBar::measureTabSizeHint(int index) const
+{
+    QString text = this->tabText(index);
+    QHash<QString, int>::const_iterator itWidth = m_hashTextWidths.constFind(text);
+    if( itWidth == m_hashTextWidths.constEnd() || text.isEmpty() ) {
+        return QTabBar::tabSizeHint(index);
+    }
+
+    bool bVertical = _isVerticalShape(this->shape());
+    TabHintModel& model = m_hashTabHintModels[this->tabHintConfig(index)];
+    if( model.samples >= 2 && model.bLinear ) {
+        int length = model.base + itWidth.value();
+        return bVertical ? QSize(model.thickness, length) : QSize(length, model.thickness);
+    }
+
+    QSize hint = QTabBar::tabSizeHint(index);
+    int base = (bVertical ? hint.height() : hint.width()) - itWidth.value();
+    int thickness = bVertical ? hint.width() : hint.height();
+    if( 0 == model.samples ) {
+        model.base = base;
+        model.thickness = thickness;
+    } else if( base != model.base || thickness != model.thickness ) {
+        model.bLinear = false;
+    }
+    ++model.samples;
+    return hint;
+}
+
+/*
+ * An entry is only used if the tab still has the text, buttons and icon, or lack of one, it was
+ * measured with, so that tabs changed through a QTabBar pointer are measured again as well.
+ */
+QSize
+GGTabBar::cachedTabSizeHint(int index, bool bMinimum) const
+{
+    //QTabBar::minimumTabSizeHint() calls tabSizeHint() with the elided text in place of the text.
+    quint64 id = this->tabId(index);
+    if( m_bMeasuringTab || 0 == id ) {
+        return this->measureTabSizeHint(index);
+    }
+
+    this->checkSizeHintKey();
+
+    QString text = this->tabText(index);
+    bool bHasIcon = !this->tabIcon(index).isNull();
+    const QWidget* pLeftButton = this->tabButton(index, QTabBar::LeftSide);
+    const QWidget* pRightButton = this->tabButton(index, QTabBar::RightSide);
+
+    SizeHintEntry& entry = m_hashSizeHints[id];
+    if( entry.text != text || entry.bHasIcon != bHasIcon || entry.pLeftButton != pLeftButton || entry.pRightButton != pRightButton ) {
+        entry.text = text;
+        entry.bHasIcon = bHasIcon;
+        entry.pLeftButton = pLeftButton;
+        entry.pRightButton = pRightButton;
+        entry.hint = QSize();
+        entry.minimumHint = QSize();
+    }
+
+    QSize hint = bMinimum ? entry.minimumHint : entry.hint;
+    if( hint.isValid() ) {
+        ++m_iSizeHintHits;
+        return hint;
+    }
+
+    ++m_iSizeHintMisses;
+    m_bMeasuringTab = true;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+    hint = bMinimum ? QTabBar::minimumTabSizeHint(index) : this->measureTabSizeHint(index);
+#else
+    hint = this->measureTabSizeHint(index);
+#endif
+    m_bMeasuringTab = false;
+
+    //Measuring does not touch the cache, so the entry is still valid.
+    (bMinimum ? entry.minimumHint : entry.hint) = hint;
+    return hint;
+}
+
+void
+GGTabBar::tabLayoutChange()
+{
+    QTabBar::tabLayoutChange();
+    this->updateRenameEditorGeometry();
+
+    //Setting buttons relayouts the tabs: do not do it from inside a layout.
+    if( (m_bVirtualized || !m_setPendingCloseButtons.isEmpty()) && !m_bUpdatingButtons && !m_bButtonsSyncPending && 0 == m_iUpdateDepth ) {
+        m_bButtonsSyncPending = true;
+        QMetaObject::invokeMethod(this, "updateVisibleTabButtons", Qt::QueuedConnection, Q_ARG(bool, m_bVirtualized));
+    }
+}
+
+void
+GGTabBar::changeEvent(QEvent* e)
+{
+    if( QEvent::FontChange == e->type() || QEvent::StyleChange == e->type() ) {
+        m_iUniformTabThickness = -1;
+        this->clearSizeHintCache();
+    }
+    if( QEvent::FontChange == e->type() || QEvent::StyleChange == e->type() || QEvent::PaletteChange == e->type() ) {
+        m_tabPixmaps.clear();
+    }
+    QTabBar::changeEvent(e);
+
+    //The style may change the icon size.
+    if( QEvent::StyleChange == e->type() ) {
+        m_iconStylePlaceholder = QIcon();
+        this->reloadTabIcons();
+    }
+}
+
+/*
+ * During a drag, and until the tabs stop sliding once it ends, QTabBar paints the tabs itself,
+ * since it moves them by private offsets. The indicators would not follow them.
+ */
+void
+GGTabBar::paintEvent(QPaintEvent* e)
+{
+    GG_TABBAR_PROFILE(PaintEvent);
+    if( !(m_bVirtualized || m_bTabPixmapCacheEnabled) || m_bTabDragged || 0 == this->count() ) {
+        QTabBar::paintEvent(e);
+    } else {
+        this->paintVisibleTabs(e);
+    }
+
+    if( m_bTabDragged ) {
+        //QTabBar repaints the bar on each step of its animations.
+        if( !m_bDragging ) {
+            m_dragSettleTimer.start();
+        }
+    } else if( !m_hashIndicators.isEmpty() ) {
+        this->paintIndicators(e);
+    }
+}
+
+/* The tabs were not repainted for a while after the drop: they are back in place. */
+void
+GGTabBar::onDragSettled()
+{
+    m_bTabDragged = false;
+    this->update();
+}
+
+/* Only paints the tabs intersecting the painted area, from the pixmap cache if enabled. */
+void
+GGTabBar::paintVisibleTabs(QPaintEvent* e)
+{
+    QStylePainter p(this);
+    int selected = this->currentIndex();
+
+    if( this->drawBase() ) {
+        QStyleOptionTabBarBase optBase;
+        optBase.initFrom(this);
+        optBase.shape = this->shape();
+        optBase.documentMode = this->documentMode();
+        optBase.tabBarRect = QTabBar::tabRect(0) | QTabBar::tabRect(this->count() - 1);
+        optBase.selectedTabRect = QTabBar::tabRect(selected);
+
+        QStyleOptionTab optOverlap;
+        optOverlap.shape = this->shape();
+        int overlap = this->style()->pixelMetric(QStyle::PM_TabBarBaseOverlap, &optOverlap, this);
+        if( overlap > 0 ) {
+            switch( this->shape() ) {
+            case QTabBar::RoundedNorth: case QTabBar::TriangularNorth:
+                optBase.rect.setRect(0, this->height() - overlap, this->width(), overlap); break;
+            case QTabBar::RoundedSouth: case QTabBar::TriangularSouth:
+                optBase.rect.setRect(0, 0, this->width(), overlap); break;
+            case QTabBar::RoundedEast: case QTabBar::TriangularEast:
+                optBase.rect.setRect(0, 0, overlap, this->height()); break;
+            case QTabBar::RoundedWest: case QTabBar::TriangularWest:
+                optBase.rect.setRect(this->width() - overlap, 0, overlap, this->height()); break;
+            }
+        }
+        p.drawPrimitive(QStyle::PE_FrameTabBarBase, optBase);
+    }
+
+    const QRect& r = e->rect();
+    int first = this->tabAtOffset(qMin(this->axisOffset(r.topLeft()), this->axisOffset(r.bottomRight())));
+    int last  = qMin(this->count() - 1, this->tabAtOffset(qMax(this->axisOffset(r.topLeft()), this->axisOffset(r.bottomRight()))));
+
+    //The selected tab overlaps its neighbours, so it is painted last.
+    for( int i = first; i <= last; ++i ) {
+        if( i == selected ) { continue; }
+
+        QStyleOptionTab opt;
+        this->initStyleOption(&opt, i);
+        this->paintTab(p, opt, i);
+    }
+    if( selected >= first && selected <= last ) {
+        QStyleOptionTab opt;
+        this->initStyleOption(&opt, selected);
+        this->paintTab(p, opt, selected);
+    }
+}
+
+void
+GGTabBar::setTabPixmapCacheEnabled(bool b)
+{
+    if( b == m_bTabPixmapCacheEnabled ) { return; }
+
+    m_bTabPixmapCacheEnabled = b;
+    if( !b ) {
+        m_tabPixmaps.clear();
+    }
+    this->update();
+}
+
+/*
+ * Like the size hints, a pixmap is only used if the tab still has the text, icon, text color
+ * and buttons it was rendered with. The text is the elided one, so it also follows the width.
+ * The pixmap has a transparent margin, since styles may draw a selected tab past its rect.
+ */
+void
+GGTabBar::paintTab(QStylePainter& p, QStyleOptionTab& opt, int index)
+{
+    if( !(opt.state & QStyle::State_Enabled) ) {
+        opt.palette.setCurrentColorGroup(QPalette::Disabled);
+    }
+    if( !m_bTabPixmapCacheEnabled ) {
+        p.drawControl(QStyle::CE_TabBarTab, opt);
+        return;
+    }
+
+    SizeHintKey paintKey;
+    paintKey.iconSize = this->iconSize();
+    paintKey.pStyle = this->style();
+    paintKey.devicePixelRatio = this->devicePixelRatioF();
+    paintKey.elideMode = this->elideMode();
+    paintKey.shape = this->shape();
+    paintKey.bDocumentMode = this->documentMode();
+    paintKey.bTabsClosable = m_bTabsClosable;
+    if( !(paintKey == m_tabPixmapKey) ) {
+        m_tabPixmaps.clear();
+        m_tabPixmapKey = paintKey;
+    }
+
+    TabPixmapKey key;
+    key.id = this->tabId(index);
+    key.state = uint(opt.state);
+    key.position = opt.position;
+    key.selectedPosition = opt.selectedPosition;
+    key.size = opt.rect.size();
+
+    qint64 iconKey = opt.icon.cacheKey();
+    QRgb textColor = this->tabTextColor(index).rgba();
+    const QPoint margin(GG_TABBAR_TAB_PIXMAP_MARGIN, GG_TABBAR_TAB_PIXMAP_MARGIN);
+
+    TabPixmapEntry* pEntry = m_tabPixmaps.object(key);
+    if( pEntry && pEntry->text == opt.text && pEntry->iconKey == iconKey && pEntry->textColor == textColor
+        && pEntry->leftButtonSize == opt.leftButtonSize && pEntry->rightButtonSize == opt.rightButtonSize ) {
+        ++m_iTabPixmapHits;
+        p.drawPixmap(opt.rect.topLeft() - margin, pEntry->pixmap);
+        return;
+    }
+    ++m_iTabPixmapMisses;
+
+    qreal dpr = this->devicePixelRatioF();
+    QPixmap pixmap((opt.rect.size() + QSize(2 * margin.x(), 2 * margin.y())) * dpr);
+    pixmap.setDevicePixelRatio(dpr);
+    pixmap.fill(Qt::transparent);
+    {
+        QStyleOptionTab optPixmap(opt);
+        optPixmap.rect.moveTopLeft(margin);
+        QPainter pixmapPainter(&pixmap);
+        pixmapPainter.setFont(p.font());
+        pixmapPainter.setPen(p.pen());
+        this->style()->drawControl(QStyle::CE_TabBarTab, &optPixmap, &pixmapPainter, this);
+    }
+    p.drawPixmap(opt.rect.topLeft() - margin, pixmap);
+
+    //QCache deletes the entry right away if it is larger than the whole budget.
+    TabPixmapEntry* pNewEntry = new TabPixmapEntry;
+    pNewEntry->text = opt.text;
+    pNewEntry->iconKey = iconKey;
+    pNewEntry->textColor = textColor;
+    pNewEntry->leftButtonSize = opt.leftButtonSize;
+    pNewEntry->rightButtonSize = opt.rightButtonSize;
+    pNewEntry->pixmap = pixmap;
+    m_tabPixmaps.insert(key, pNewEntry, pixmap.width() * pixmap.height() * 4);
+}
+
+/*
+ * The progress is a line along the bottom of the tab, the badge a pill in its top right corner.
+ * Only the tabs intersecting the painted area are looked up.
+ */
+void
+GGTabBar::paintIndicators(QPaintEvent* e)
 {
+    QPainter p(this);
+    p.setRenderHint(QPainter::Antialiasing);
+    const QPalette& palette = this->palette();
+
+    const QRect& painted = e->rect();
+    int first = this->tabAtOffset(qMin(this->axisOffset(painted.topLeft()), this->axisOffset(painted.bottomRight())));
+    int last  = qMin(this->count() - 1, this->tabAtOffset(qMax(this->axisOffset(painted.topLeft()), this->axisOffset(painted.bottomRight()))));
+
+    for( int index = first; index <= last; ++index ) {
+        QHash<quint64, TabIndicators>::const_iterator it = m_hashIndicators.constFind(this->tabId(index));
+        if( it == m_hashIndicators.constEnd() ) { continue; }
+
+        QRect r = this->tabRect(index);
+
+        const TabIndicators& indicators = it.value();
+        if( indicators.progress >= 0 ) {
+            QRect bar(r.left() + 2, r.bottom() - 2, (r.width() - 4) * indicators.progress / 100, 2);
+            p.fillRect(bar, palette.highlight());
+        }
+        if( indicators.badge > 0 ) {
+            QString text = _badgeText(indicators.badge);
+            int height = this->fontMetrics().height();
+            QRect badge(r.right() - this->badgeWidth(indicators.badge) - 2, r.top() + 2, this->badgeWidth(indicators.badge), height);
+            p.setPen(Qt::NoPen);
+            p.setBrush(palette.highlight());
+            p.drawRoundedRect(badge, height / 2.0, height / 2.0);
+            p.setPen(palette.color(QPalette::HighlightedText));
+            p.drawText(badge, Qt::AlignCenter, text);
+        }
+    }
 }
 
 void 
 GGTabBar::mousePressEvent(QMouseEvent * e)
 {
     m_bDragging = true;
+    m_pressPos = e->pos();
     QTabBar::mousePressEvent(e);
 }
 
+/* A pressed tab of a movable bar is dragged once the mouse moves past the start drag distance. */
 void 
 GGTabBar::mouseMoveEvent(QMouseEvent * e)
 {
+    if( m_bDragging && this->isMovable() && !m_bTabDragged && (e->buttons() & Qt::LeftButton)
+        && (e->pos() - m_pressPos).manhattanLength() > QApplication::startDragDistance() ) {
+        m_bTabDragged = true;
+        m_dragSettleTimer.stop();
+    }
+
     e->ignore(); //The event must go to the GGTabBar parent.
     QTabBar::mouseMoveEvent(e);
 }
@@ -41,6 +2069,9 @@ void
 GGTabBar::mouseReleaseEvent(QMouseEvent* e)
 {
     m_bDragging = false;
+    if( m_bTabDragged ) {
+        m_dragSettleTimer.start();
+    }
     
     if( Qt::MiddleButton == e->button() ) {
         this->tabCloseRequested(this->tabAt(e->pos()));
@@ -59,37 +2090,97 @@ GGTabBar::mouseDoubleClickEvent(QMouseEvent* e)
     emit tabDoubleClicked(iTabIndex);
 
     if( m_bRenameOnDoubleClick ) {
-        startRename(iTabIndex);
+        this->startRename(iTabIndex);
     }
 }
 
+/* The editor is created by the first rename, then hidden and reused. */
 void
-GGTabBar::startRename(int iTabIndex)
+GGTabBar::startRename(int index)
 {
-    static const int c_iVerticalMargin   = 3;
-    static const int c_iHorizontalMargin = 6;
-
-    if (m_iEditedTabIndex != -1) {
+    GG_TABBAR_PROFILE(Rename);
+    if( 0 != m_iEditedTabId || index < 0 || index >= this->count() ) {
         return;
     }
-    m_iEditedTabIndex = iTabIndex;
-    QRect currentTabRect = tabRect(iTabIndex);
-    m_pTabNameEdit = new QLineEdit(this);
-    m_pTabNameEdit->show();
-    m_pTabNameEdit->move(currentTabRect.left() + c_iHorizontalMargin, currentTabRect.top() + c_iVerticalMargin);
-    m_pTabNameEdit->resize(currentTabRect.width() - 2 * c_iHorizontalMargin, currentTabRect.height() - 2 * c_iVerticalMargin);
-    m_pTabNameEdit->setText(tabText(iTabIndex));
+
+    if( !m_pTabNameEdit ) {
+        m_pTabNameEdit = new QLineEdit(this);
+        m_pTabNameEdit->hide();
+        m_pTabNameEdit->installEventFilter(this);
+        connect(m_pTabNameEdit, &QLineEdit::editingFinished, this, &GGTabBar::finishRename);
+    }
+    m_iEditedTabId = this->tabId(index);
+    this->updateRenameEditorGeometry();
+    m_pTabNameEdit->setText(this->tabText(index));
     m_pTabNameEdit->selectAll();
+    m_pTabNameEdit->show();
     m_pTabNameEdit->setFocus();
-    connect(m_pTabNameEdit, SIGNAL(editingFinished()), this, SLOT(finishRename()));
 }
 
+/*
+ * Called on Return and when the editor loses the focus. A rejected text keeps the editor open on
+ * Return, but there is nobody left to correct it once the focus is gone.
+ */
 void
 GGTabBar::finishRename()
 {
-    setTabText(m_iEditedTabIndex, m_pTabNameEdit->text());
-    m_pTabNameEdit->deleteLater();
-    m_iEditedTabIndex = -1;
+    GG_TABBAR_PROFILE(Rename);
+    if( 0 == m_iEditedTabId ) { return; }
+
+    if( !this->commitRename() && !m_pTabNameEdit->hasFocus() ) {
+        this->cancelRename();
+    }
+}
+
+/* The size hint of the tab is the only one dropped: the other tabs are not measured again. */
+bool
+GGTabBar::commitRename()
+{
+    int index = this->renamedTab();
+    if( index < 0 ) { return false; }
+
+    QString text = m_pTabNameEdit->text();
+    if( m_renameValidator && !m_renameValidator(index, text) ) {
+        return false;
+    }
+
+    m_iEditedTabId = 0;
+    m_pTabNameEdit->hide();
+    if( m_pModel ) {
+        //The tab is renamed when the model emits dataChanged.
+        m_pModel->setData(m_pModel->index(index, m_iModelColumn), text, m_aModelRoles[TextRole]);
+    } else if( text != this->tabText(index) ) {
+        this->setTabText(index, text);
+    }
+    return true;
+}
+
+void
+GGTabBar::cancelRename()
+{
+    if( 0 == m_iEditedTabId ) { return; }
+
+    int index = this->renamedTab();
+    m_iEditedTabId = 0;
+    m_pTabNameEdit->hide();
+    emit renameCanceled(index);
+}
+
+/* The editor is a child of the tab bar, so it already follows it when it is scrolled. */
+void
+GGTabBar::updateRenameEditorGeometry()
+{
+    static const int c_iVerticalMargin   = 3;
+    static const int c_iHorizontalMargin = 6;
+
+    //Called on every layout: without a rename, the id-to-index table is not rebuilt.
+    if( 0 == m_iEditedTabId ) { return; }
+
+    int index = this->renamedTab();
+    if( index < 0 ) { return; }
+
+    QRect r = this->tabRect(index);
+    m_pTabNameEdit->setGeometry(r.adjusted(c_iHorizontalMargin, c_iVerticalMargin, -c_iHorizontalMargin, -c_iVerticalMargin));
 }
 
 /* ------------------------------------------------------------------------- */
@@ -98,6 +2189,18 @@ GGTabBar::finishRename()
 GGScrollableTabBar::GGScrollableTabBar(QWidget* parent)
     : QScrollArea(parent)
     , m_pTabBar(nullptr)
+    , m_iAutoScrollDistance(0)
+    , m_dAutoScrollVelocity(0.0)
+    , m_dAutoScrollRemainder(0.0)
+    , m_iMaxScrollSpeed(GG_TABBAR_DEFAULT_MAX_SCROLL_SPEED)
+    , m_iScrollAcceleration(GG_TABBAR_DEFAULT_SCROLL_ACCELERATION)
+    , m_iPendingUpdates(0)
+    , m_bPendingFlushQueued(false)
+    , m_iPendingRequests(0)
+    , m_iMergedRequests(0)
+    , m_iPendingFlushes(0)
+    , m_iPendingScrollOffset(-1)
+    , m_bScrollOffsetRetried(false)
 {
     m_pTabBar = new GGTabBar(this);
     m_pTabBar->setMovable(true);
@@ -113,17 +2216,47 @@ GGScrollableTabBar::GGScrollableTabBar(QWidget* parent)
     this->horizontalScrollBar()->setStyleSheet("QScrollBar {height:0px;}");
     this->horizontalScrollBar()->hide();
 
-    connect(m_pTabBar, SIGNAL(currentChanged(int)),      this, SLOT(onCurrentChanged(int)));
-    connect(m_pTabBar, SIGNAL(tabCloseRequested(int)),   this, SLOT(onTabCloseRequested(int)));
-    connect(m_pTabBar, SIGNAL(tabMoved(int, int)),       this, SLOT(onTabMoved(int, int)));
-    connect(m_pTabBar, SIGNAL(tabBarClicked(int)),       this, SLOT(onTabBarClicked(int)));
-    connect(m_pTabBar, SIGNAL(tabBarDoubleClicked(int)), this, SLOT(onTabBarDoubleClicked(int)));
+    m_autoScrollTimer.setInterval(GG_TABBAR_AUTOSCROLL_INTERVAL);
+    m_autoScrollTimer.setTimerType(Qt::PreciseTimer);
+
+    connect(&m_autoScrollTimer, &QTimer::timeout, this, &GGScrollableTabBar::autoScroll);
+    connect(this->horizontalScrollBar(), &QAbstractSlider::valueChanged, this, &GGScrollableTabBar::updateViewportRect);
+    //The signals are forwarded signal to signal, without relay slot.
+    connect(m_pTabBar, &QTabBar::currentChanged,        this, &GGScrollableTabBar::makeCurrentVisible);
+    connect(m_pTabBar, &GGTabBar::updateStarted,        this, &GGScrollableTabBar::onUpdateStarted);
+    connect(m_pTabBar, &GGTabBar::tabsChanged,          this, &GGScrollableTabBar::onTabsChanged);
+    connect(m_pTabBar, &GGTabBar::tabsChanged,          this, &GGScrollableTabBar::tabsChanged);
+    connect(m_pTabBar, &QTabBar::tabCloseRequested,     this, &GGScrollableTabBar::tabCloseRequested);
+    connect(m_pTabBar, &QTabBar::tabBarClicked,         this, &GGScrollableTabBar::tabBarClicked);
+    connect(m_pTabBar, &QTabBar::tabBarDoubleClicked,   this, &GGScrollableTabBar::tabBarDoubleClicked);
+    connect(m_pTabBar, &GGTabBar::tabAdded,             this, &GGScrollableTabBar::tabAdded);
+    connect(m_pTabBar, &GGTabBar::tabAboutToBeRemoved,  this, &GGScrollableTabBar::tabAboutToBeRemoved);
+    connect(m_pTabBar, &GGTabBar::tabTextChanged,       this, &GGScrollableTabBar::tabTextChanged);
+    _forwardIndexSignals(m_pTabBar, this, true);
 }
 
 GGScrollableTabBar::~GGScrollableTabBar()
 {
 }
 
+void
+GGScrollableTabBar::onUpdateStarted()
+{
+    _forwardIndexSignals(m_pTabBar, this, false);
+}
+
+/* The tab bar reports the change of its current tab, if any, right after. */
+void
+GGScrollableTabBar::onTabsChanged()
+{
+    GG_TABBAR_PROFILE(SignalForwarding);
+    _forwardIndexSignals(m_pTabBar, this, true);
+    this->requestPendingUpdate(PendingHeight);
+    if( m_iPendingScrollOffset >= 0 ) {
+        this->requestPendingUpdate(PendingScroll);
+    }
+}
+
 bool 
 GGScrollableTabBar::blockSignals(bool block)
 {
@@ -134,25 +2267,39 @@ GGScrollableTabBar::blockSignals(bool block)
 bool 
 GGScrollableTabBar::eventFilter(QObject* o, QEvent* e)
 {
-    //This works because QScrollArea::setWidget installs an eventFilter on the widget
-    if(o && o == m_pTabBar && e->type() == QEvent::Resize) {
-        this->setMaximumHeight(m_pTabBar->minimumSizeHint().height());
-        QTimer::singleShot(0, this, SLOT(makeCurrentVisible()));
+    //This works because QScrollArea::setWidget installs an eventFilter on the widget.
+    //During an update, onTabsChanged() makes the same requests once the update ends.
+    if(o && o == m_pTabBar && e->type() == QEvent::Resize && !m_pTabBar->isUpdating()) {
+        this->requestPendingUpdate(PendingHeight);
+        if( m_iPendingScrollOffset >= 0 ) {
+            this->requestPendingUpdate(PendingScroll);
+        }
+        this->requestPendingUpdate(PendingVisibility);
     }
  
     return QScrollArea::eventFilter(o, e);
 }
 
+/* Only records how far past an edge the cursor is: autoScroll() does the scrolling. */
 void
 GGScrollableTabBar::mouseMoveEvent(QMouseEvent* e)
 {
     QPoint pos = e->pos();
     int w = this->width();
+    int distance = pos.x() > w ? pos.x() - w : qMin(pos.x(), 0);
 
-    if( pos.x() > w ) {
-        this->scroll(qMin((pos.x() - w) / 2, GG_TABBAR_MAX_SCROLL_SPEED));
-    } else if( pos.x() < 0 ) {
-        this->scroll(qMax(pos.x() / 2, -GG_TABBAR_MAX_SCROLL_SPEED));
+    if( 0 == distance || !m_pTabBar->isDragging() ) {
+        this->stopAutoScroll();
+    } else {
+        if( (distance > 0) != (m_iAutoScrollDistance > 0) ) {
+            m_dAutoScrollVelocity = 0.0;
+            m_dAutoScrollRemainder = 0.0;
+        }
+        m_iAutoScrollDistance = distance;
+        if( !m_autoScrollTimer.isActive() ) {
+            m_autoScrollClock.start();
+            m_autoScrollTimer.start();
+        }
     }
     QWidget::mouseMoveEvent(e);
 }
@@ -160,6 +2307,7 @@ GGScrollableTabBar::mouseMoveEvent(QMouseEvent* e)
 void 
 GGScrollableTabBar::mouseReleaseEvent(QMouseEvent* e)
 {
+    this->stopAutoScroll();
     this->makeCurrentVisible();
     QScrollArea::mouseReleaseEvent(e);
 }
@@ -169,26 +2317,155 @@ GGScrollableTabBar::resizeEvent(QResizeEvent* e)
 {
     this->makeCurrentVisible();
     QScrollArea::resizeEvent(e);
+    this->updateViewportRect();
 }
 
-/* If the scroll area is smaller that the tab to make visible, ensure that its left part will be at least visible. */
+/*
+ * If the scroll area is smaller that the tab to make visible, ensure that its left part will be at least visible.
+ * The scroll bar is set once, to the value both edges of the tab lead to.
+ */
 void 
 GGScrollableTabBar::makeVisible(int index)
 {
-    if( m_pTabBar->isDragging() ) { return; }
+    GG_TABBAR_PROFILE(MakeVisible);
+    if( m_pTabBar->isDragging() || index < 0 ) { return; }
 
     const QRect& r = m_pTabBar->tabRect(index);
-    this->ensureVisible(r.x() + r.width(), 0, 0, 0);
-    this->ensureVisible(r.x(), 0, 0, 0);
+    QScrollBar* s = this->horizontalScrollBar();
+    int width = this->viewport()->width();
+    int value = s->value();
+
+    if( r.x() + r.width() > value + width ) {
+        value = r.x() + r.width() - width;
+    }
+    if( r.x() < value ) {
+        value = r.x();
+    }
+    if( value != s->value() ) {
+        s->setValue(value);
+    }
+}
+
+/* The first request of an event loop iteration queues the flush, the next ones are merged into it. */
+void
+GGScrollableTabBar::requestPendingUpdate(PendingUpdate update)
+{
+    ++m_iPendingRequests;
+    m_iPendingUpdates |= update;
+
+    if( m_bPendingFlushQueued ) {
+        ++m_iMergedRequests;
+        return;
+    }
+    m_bPendingFlushQueued = true;
+    QMetaObject::invokeMethod(this, "flushPendingUpdates", Qt::QueuedConnection);
+}
+
+/*
+ * The height first, since it can change the size of the viewport, then the scroll offset,
+ * so that the current tab is made visible from it.
+ * A scroll offset the tab bar is too small for is tried again once, when the tab bar is resized:
+ * the tabs added just before may not be laid out yet.
+ */
+void
+GGScrollableTabBar::flushPendingUpdates()
+{
+    int updates = m_iPendingUpdates;
+    m_iPendingUpdates = 0;
+    m_bPendingFlushQueued = false;
+    ++m_iPendingFlushes;
+
+    if( updates & PendingHeight ) {
+        this->setMaximumHeight(m_pTabBar->minimumSizeHint().height());
+    }
+    if( (updates & PendingScroll) && m_iPendingScrollOffset >= 0 ) {
+        QScrollBar* s = this->horizontalScrollBar();
+        s->setValue(m_iPendingScrollOffset);
+        if( s->value() == m_iPendingScrollOffset || m_bScrollOffsetRetried ) {
+            m_iPendingScrollOffset = -1;
+        }
+        m_bScrollOffsetRetried = true;
+    }
+    if( updates & PendingVisibility ) {
+        this->makeVisible(m_pTabBar->currentIndex());
+    }
+}
+
+int
+GGScrollableTabBar::scrollOffset() const
+{
+    return this->horizontalScrollBar()->value();
+}
+
+void
+GGScrollableTabBar::setScrollOffset(int offset)
+{
+    m_iPendingScrollOffset = qMax(0, offset);
+    m_bScrollOffsetRetried = false;
+    this->requestPendingUpdate(PendingScroll);
 }
 
 void 
 GGScrollableTabBar::scroll(int dx)
 {
+    GG_TABBAR_PROFILE(Scroll);
     QScrollBar* s = this->horizontalScrollBar();
     s->setValue(s->value() + dx);
 }
 
+/*
+ * The velocity moves towards the speed given by the distance to the edge, by at most
+ * scrollAcceleration() per second, and the fractions of pixels are carried to the next frame.
+ * The dragged tab only follows the mouse moves, so one is sent to the tab bar after scrolling.
+ */
+void
+GGScrollableTabBar::autoScroll()
+{
+    if( !m_pTabBar->isDragging() || !(QApplication::mouseButtons() & Qt::LeftButton) ) {
+        this->stopAutoScroll();
+        return;
+    }
+
+    double dt = m_autoScrollClock.nsecsElapsed() / 1e9;
+    m_autoScrollClock.start();
+
+    double target = qMin(double(m_iMaxScrollSpeed), qAbs(m_iAutoScrollDistance) * double(GG_TABBAR_AUTOSCROLL_GAIN));
+    m_dAutoScrollVelocity = qMin(target, m_dAutoScrollVelocity + m_iScrollAcceleration * dt);
+    m_dAutoScrollRemainder += (m_iAutoScrollDistance > 0 ? 1.0 : -1.0) * m_dAutoScrollVelocity * dt;
+
+    int dx = int(m_dAutoScrollRemainder);
+    if( 0 == dx ) { return; }
+    m_dAutoScrollRemainder -= dx;
+
+    QScrollBar* s = this->horizontalScrollBar();
+    int value = s->value();
+    this->scroll(dx);
+    if( s->value() == value ) {
+        this->stopAutoScroll(); //An end of the tab bar is reached.
+        return;
+    }
+
+    QMouseEvent move(QEvent::MouseMove, m_pTabBar->mapFromGlobal(QCursor::pos()), Qt::NoButton,
+                     QApplication::mouseButtons(), QApplication::keyboardModifiers());
+    QApplication::sendEvent(m_pTabBar, &move);
+}
+
+void
+GGScrollableTabBar::stopAutoScroll()
+{
+    m_autoScrollTimer.stop();
+    m_iAutoScrollDistance = 0;
+    m_dAutoScrollVelocity = 0.0;
+    m_dAutoScrollRemainder = 0.0;
+}
+
+void
+GGScrollableTabBar::updateViewportRect()
+{
+    QWidget* pViewport = this->viewport();
+    m_pTabBar->setViewportRect(QRect(m_pTabBar->mapFrom(pViewport, QPoint(0, 0)), pViewport->size()));
+}
+
 void 
 GGScrollableTabBar::adjustHeight()
 {
@@ -203,26 +2480,69 @@ GGTabBarWidget::GGTabBarWidget(QWidget* parent)
     : QWidget(parent)
     , m_pMenuButton(nullptr)
     , m_pScrollableTabBar(nullptr)
+    , m_pMenuModel(nullptr)
+    , m_pMenuPopup(nullptr)
+    , m_bMenuDirty(false)
+    , m_pUpdateQueue(nullptr)
+    , m_pSwitcherPopup(nullptr)
+    , m_pSwitcherShortcut(nullptr)
+    , m_pSwitcherBackShortcut(nullptr)
+    , m_iTabSwitcherSize(GG_TABBAR_DEFAULT_TAB_SWITCHER_SIZE)
+    , m_bCoalescedNotifications(false)
+    , m_bTabsChangedQueued(false)
+    , m_iClosedTabBytes(0)
+    , m_iMaxClosedTabs(GG_TABBAR_DEFAULT_MAX_CLOSED_TABS)
+    , m_iMaxClosedTabBytes(GG_TABBAR_DEFAULT_MAX_CLOSED_TAB_BYTES)
+    , m_pLayout(nullptr)
+    , m_pPageStack(nullptr)
+    , m_iLoadedPageCost(0)
+    , m_iMaxLoadedPages(GG_TABBAR_DEFAULT_MAX_LOADED_PAGES)
+    , m_iMaxLoadedPageCost(0)
 {
-    QHBoxLayout* pLayout = new QHBoxLayout(this);
+    //The page stack is added below the bar by setPageFactory().
+    m_pLayout = new QVBoxLayout(this);
+    m_pLayout->setMargin(0);
+    m_pLayout->setSpacing(0);
+    QHBoxLayout* pLayout = new QHBoxLayout;
     pLayout->setMargin(0);
+    m_pLayout->addLayout(pLayout);
 
     m_pScrollableTabBar = new GGScrollableTabBar(this);
     m_pMenuButton = new QToolButton(this);
     pLayout->addWidget(m_pScrollableTabBar);
     pLayout->addWidget(m_pMenuButton);
 
-    m_pMenuButton->setMenu(new QMenu(m_pMenuButton));
+    m_pMenuModel = new GGTabMenuModel(this);
+    m_pMenuPopup = new GGTabMenuPopup(m_pMenuModel, this);
     m_pMenuButton->hide();
-    m_pMenuButton->setStyleSheet("QToolButton::menu-indicator { image: none; }"); //Remove the menu-indicator as there is an image already.
-    m_pMenuButton->menu()->setStyleSheet("QMenu { menu-scrollable: 1; }"); //Makes the Menu scrollable instead of multi-columns
 
-    connect(m_pMenuButton,       SIGNAL(clicked()),                this, SLOT(displayMenu()));
-    connect(m_pScrollableTabBar, SIGNAL(currentChanged(int)),      this, SLOT(onCurrentChanged(int)));
-    connect(m_pScrollableTabBar, SIGNAL(tabCloseRequested(int)),   this, SLOT(onTabCloseRequested(int)));
-    connect(m_pScrollableTabBar, SIGNAL(tabMoved(int, int)),       this, SLOT(onTabMoved(int, int)));
-    connect(m_pScrollableTabBar, SIGNAL(tabBarClicked(int)),       this, SLOT(onTabBarClicked(int)));
-    connect(m_pScrollableTabBar, SIGNAL(tabBarDoubleClicked(int)), this, SLOT(onTabBarDoubleClicked(int)));
+    m_pUpdateQueue = new GGTabUpdateQueue(this);
+
+    m_pSwitcherPopup = new GGTabSwitcherPopup(this);
+    m_pSwitcherShortcut = new QShortcut(QKeySequence(Qt::CTRL + Qt::Key_Tab), this);
+    m_pSwitcherShortcut->setContext(Qt::WidgetWithChildrenShortcut);
+    m_pSwitcherBackShortcut = new QShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_Tab), this);
+    m_pSwitcherBackShortcut->setContext(Qt::WidgetWithChildrenShortcut);
+
+    connect(m_pMenuButton,           &QAbstractButton::clicked,            this, &GGTabBarWidget::displayMenu);
+    connect(m_pMenuPopup,            &GGTabMenuPopup::tabActivated,       this, &GGTabBarWidget::onMenuTabActivated);
+    connect(m_pSwitcherPopup,        &GGTabSwitcherPopup::tabActivated,   this, &GGTabBarWidget::onMenuTabActivated);
+    connect(m_pSwitcherShortcut,     &QShortcut::activated,               this, &GGTabBarWidget::showTabSwitcher);
+    connect(m_pSwitcherBackShortcut, &QShortcut::activated,               this, &GGTabBarWidget::showTabSwitcherBackward);
+    connect(m_pUpdateQueue,          &GGTabUpdateQueue::updatesReady,     this, &GGTabBarWidget::applyTabUpdates);
+
+    //Connected to the inner tab bar, so that each signal is dispatched once.
+    GGTabBar* pTabBar = m_pScrollableTabBar->tabBar();
+    connect(pTabBar, &QTabBar::currentChanged,        this, &GGTabBarWidget::onCurrentChanged);
+    connect(pTabBar, &GGTabBar::updateStarted,        this, &GGTabBarWidget::updateSignalForwarding);
+    connect(pTabBar, &GGTabBar::tabsChanged,          this, &GGTabBarWidget::onTabsChanged);
+    connect(pTabBar, &GGTabBar::tabAdded,             this, &GGTabBarWidget::onTabAdded);
+    connect(pTabBar, &GGTabBar::tabAboutToBeRemoved,  this, &GGTabBarWidget::onTabAboutToBeRemoved);
+    connect(pTabBar, &GGTabBar::tabTextChanged,       this, &GGTabBarWidget::onTabTextChanged);
+    connect(pTabBar, &QTabBar::tabCloseRequested,     this, &GGTabBarWidget::tabCloseRequested);
+    connect(pTabBar, &QTabBar::tabBarClicked,         this, &GGTabBarWidget::tabBarClicked);
+    connect(pTabBar, &QTabBar::tabBarDoubleClicked,   this, &GGTabBarWidget::tabBarDoubleClicked);
+    this->updateSignalForwarding();
 }
 
 GGTabBarWidget::~GGTabBarWidget() 
@@ -236,42 +2556,533 @@ GGTabBarWidget::blockSignals(bool block)
     return QWidget::blockSignals(block);
 }
 
-static bool
-_tabBarMenuActionLessThan(QAction* p1, QAction* p2)
+void
+GGTabBarWidget::displayMenu()
+{
+    GG_TABBAR_PROFILE(DisplayMenu);
+    bool bByRecency = this->isMenuSortedByRecency();
+
+    //During a batch, the menu is not updated tab by tab but rebuilt here, once.
+    if( m_bMenuDirty ) {
+        QVector<quint64> lIds;
+        QStringList lTexts;
+        lTexts.reserve(this->count());
+        if( bByRecency ) {
+            lIds = this->recentTabs();
+            for( int i = 0; i < lIds.size(); ++i ) {
+                lTexts.append(this->tabText(this->tabIndex(lIds.at(i))));
+            }
+        } else {
+            lIds.reserve(this->count());
+            for( int i = 0; i < this->count(); ++i ) {
+                lIds.append(this->tabId(i));
+                lTexts.append(this->tabText(i));
+            }
+        }
+        m_pMenuModel->resetTabs(lIds, lTexts);
+        m_bMenuDirty = false;
+    } else if( bByRecency ) {
+        //The recency order is not followed tab by tab, only taken when the menu is shown.
+        m_pMenuModel->setRecentTabs(this->recentTabs());
+    }
+
+    m_pMenuPopup->popup(m_pMenuButton, this->tabId(this->currentIndex()));
+}
+
+void 
+GGTabBarWidget::onMenuTabActivated(quint64 id)
+{
+    int tabIndex = m_pScrollableTabBar->tabIndex(id);
+    if( tabIndex >= 0 ) {
+        m_pScrollableTabBar->setCurrentIndex(tabIndex);
+    }
+}
+
+QVector<quint64>
+GGTabBarWidget::recentTabs(int count) const
+{
+    return QVector<quint64>::fromList(m_tabRecency.toList(count));
+}
+
+bool
+GGTabBarWidget::isMenuSortedByRecency() const
 {
-    return p1->text() < p2->text();
+    return GGTabMenuModel::SortByRecency == m_pMenuModel->sortMode();
 }
 
 void
-GGTabBarWidget::displayMenu()
+GGTabBarWidget::setMenuSortedByRecency(bool b)
 {
-    QMenu* pMenu = m_pMenuButton->menu();
-    QList<QAction*> lActions;
+    m_pMenuModel->setSortMode(b ? GGTabMenuModel::SortByRecency : GGTabMenuModel::SortByText);
+}
 
-    pMenu->clear();
+bool
+GGTabBarWidget::isTabSwitcherEnabled() const
+{
+    return m_pSwitcherShortcut->isEnabled();
+}
 
-    for( int i = 0; i < m_pScrollableTabBar->count(); ++i )
-    {
-        QAction* pAct = new QAction(m_pScrollableTabBar->tabText(i), pMenu);
-        pAct->setData(i);
+void
+GGTabBarWidget::setTabSwitcherEnabled(bool b)
+{
+    m_pSwitcherShortcut->setEnabled(b);
+    m_pSwitcherBackShortcut->setEnabled(b);
+}
+
+void
+GGTabBarWidget::setNotificationsCoalesced(bool b)
+{
+    if( b == m_bCoalescedNotifications ) { return; }
+
+    m_bCoalescedNotifications = b;
+    this->updateSignalForwarding();
+}
 
-        lActions.append(pAct);
+/* When coalesced, the moves queue tabsChanged() instead of being forwarded. */
+void
+GGTabBarWidget::updateSignalForwarding()
+{
+    GGTabBar* pTabBar = m_pScrollableTabBar->tabBar();
+    bool bUpdating = pTabBar->isUpdating();
+    _forwardIndexSignals(pTabBar, this, !m_bCoalescedNotifications && !bUpdating);
+    if( m_bCoalescedNotifications && !bUpdating ) {
+        connect(pTabBar, &QTabBar::tabMoved, this, &GGTabBarWidget::queueTabsChanged, Qt::UniqueConnection);
+    } else {
+        disconnect(pTabBar, &QTabBar::tabMoved, this, &GGTabBarWidget::queueTabsChanged);
     }
+}
+
+/* However many changes are queued until the event loop runs, tabsChanged() is emitted once. */
+void
+GGTabBarWidget::queueTabsChanged()
+{
+    if( m_bTabsChangedQueued ) { return; }
+
+    m_bTabsChangedQueued = true;
+    QMetaObject::invokeMethod(this, "emitQueuedTabsChanged", Qt::QueuedConnection);
+}
+
+void
+GGTabBarWidget::emitQueuedTabsChanged()
+{
+    m_bTabsChangedQueued = false;
+    emit tabsChanged();
+}
+
+/*
+ * Lists the tabSwitcherSize() most recent tabs, with the previous one selected (the last one
+ * backward). Without Ctrl held, as when called from code, there is no release to wait for:
+ * that tab is activated right away.
+ */
+void
+GGTabBarWidget::switchTab(bool bBackward)
+{
+    QList<quint64> lRecentIds = m_tabRecency.toList(m_iTabSwitcherSize);
+    if( lRecentIds.size() < 2 ) { return; }
 
-    qSort(lActions.begin(), lActions.end(), _tabBarMenuActionLessThan);
-    pMenu->addActions(lActions);
-    connect(pMenu, SIGNAL(triggered(QAction*)), this, SLOT(onMenuAction(QAction*)));
+    int row = bBackward ? lRecentIds.size() - 1 : 1;
+    if( !(QApplication::keyboardModifiers() & Qt::ControlModifier) ) {
+        this->onMenuTabActivated(lRecentIds.at(row));
+        return;
+    }
 
-    if( !pMenu->isEmpty() ) {
-        m_pMenuButton->showMenu();
+    QVector<quint64> lIds;
+    QStringList lTexts;
+    QList<QIcon> lIcons;
+    lIds.reserve(lRecentIds.size());
+    for( int i = 0; i < lRecentIds.size(); ++i ) {
+        int index = this->tabIndex(lRecentIds.at(i));
+        lIds.append(lRecentIds.at(i));
+        lTexts.append(this->tabText(index));
+        lIcons.append(this->tabIcon(index));
     }
+    m_pSwitcherPopup->popup(this, lIds, lTexts, lIcons, row);
 }
 
-void 
-GGTabBarWidget::onMenuAction(QAction* pAction)
+void
+GGTabBarWidget::postTabText(quint64 id, const QString& text)
+{
+    m_pUpdateQueue->postTabText(id, text);
+}
+
+void
+GGTabBarWidget::postTabTextColor(quint64 id, const QColor& color)
+{
+    m_pUpdateQueue->postTabTextColor(id, color);
+}
+
+void
+GGTabBarWidget::postTabIcon(quint64 id, const QImage& icon)
+{
+    m_pUpdateQueue->postTabIcon(id, icon);
+}
+
+/* Texts and icons change the layout: several of them are applied in a single update. */
+void
+GGTabBarWidget::applyTabUpdates()
+{
+    QHash<quint64, GGTabUpdate> updates = m_pUpdateQueue->takeAll();
+
+    int relayouts = 0;
+    for( QHash<quint64, GGTabUpdate>::const_iterator it = updates.constBegin(); it != updates.constEnd(); ++it ) {
+        if( it.value().fields & (GGTabUpdate::TextField | GGTabUpdate::IconField) ) {
+            ++relayouts;
+        }
+    }
+
+    bool bBatch = relayouts > 1;
+    if( bBatch ) {
+        this->beginUpdate();
+    }
+    for( QHash<quint64, GGTabUpdate>::const_iterator it = updates.constBegin(); it != updates.constEnd(); ++it ) {
+        const GGTabUpdate& update = it.value();
+        int index = this->tabIndex(update.id);
+        if( index < 0 ) { continue; }
+
+        if( QAbstractItemModel* pModel = this->model() ) {
+            //The tab follows its row when the model emits dataChanged.
+            QModelIndex modelIndex = pModel->index(index, this->modelColumn());
+            if( (update.fields & GGTabUpdate::TextField) && update.text != this->tabText(index) ) {
+                pModel->setData(modelIndex, update.text, this->roleMapping(GGTabBar::TextRole));
+            }
+            if( update.fields & GGTabUpdate::TextColorField ) {
+                pModel->setData(modelIndex, update.textColor, this->roleMapping(GGTabBar::TextColorRole));
+            }
+            if( update.fields & GGTabUpdate::IconField ) {
+                pModel->setData(modelIndex, QIcon(QPixmap::fromImage(update.icon)), this->roleMapping(GGTabBar::IconRole));
+            }
+            continue;
+        }
+        if( (update.fields & GGTabUpdate::TextField) && update.text != this->tabText(index) ) {
+            this->setTabText(index, update.text);
+        }
+        if( update.fields & GGTabUpdate::TextColorField ) {
+            this->setTabTextColor(index, update.textColor);
+        }
+        if( update.fields & GGTabUpdate::IconField ) {
+            this->setTabIcon(index, QIcon(QPixmap::fromImage(update.icon)));
+        }
+    }
+    if( bBatch ) {
+        this->endUpdate();
+    }
+}
+
+void
+GGTabBarWidget::onTabAdded(int index)
+{
+    GG_TABBAR_PROFILE(SignalForwarding);
+    m_tabRecency.append(this->tabId(index));
+    m_pMenuButton->show();
+    if( m_bCoalescedNotifications && !this->isUpdating() ) {
+        this->queueTabsChanged();
+    }
+    if( m_bMenuDirty || this->isUpdating() ) {
+        m_bMenuDirty = true;
+        return;
+    }
+    m_pMenuModel->insertTab(this->tabId(index), this->tabText(index));
+}
+
+void
+GGTabBarWidget::onTabAboutToBeRemoved(int index)
+{
+    GG_TABBAR_PROFILE(SignalForwarding);
+    quint64 id = this->tabId(index);
+    m_tabRecency.remove(id);
+    m_hashPageStates.remove(id);
+    this->destroyPage(id, false);
+
+    //Tabs may also be removed by the model or the tab bar itself.
+    if( 1 == this->count() && !this->isUpdating() ) {
+        m_pMenuButton->hide();
+    }
+    if( m_bCoalescedNotifications && !this->isUpdating() ) {
+        this->queueTabsChanged();
+    }
+    if( m_bMenuDirty || this->isUpdating() ) {
+        m_bMenuDirty = true;
+        return;
+    }
+    m_pMenuModel->removeTab(id);
+}
+
+void
+GGTabBarWidget::onTabTextChanged(int index)
+{
+    GG_TABBAR_PROFILE(SignalForwarding);
+    if( m_bMenuDirty || this->isUpdating() ) {
+        m_bMenuDirty = true;
+        return;
+    }
+    m_pMenuModel->renameTab(this->tabId(index), this->tabText(index));
+}
+
+void
+GGTabBarWidget::onTabsChanged()
+{
+    this->updateSignalForwarding();
+    m_pMenuButton->setVisible(this->count() > 0);
+    //The current tab may have been set during the batch without currentChanged().
+    if( this->currentIndex() >= 0 ) {
+        m_tabRecency.touch(this->tabId(this->currentIndex()));
+    }
+    this->showCurrentPage();
+    if( m_bCoalescedNotifications ) {
+        this->queueTabsChanged();
+    } else {
+        emit tabsChanged();
+    }
+}
+
+/* The signal itself is forwarded signal to signal, unless notifications are coalesced. */
+void
+GGTabBarWidget::onCurrentChanged(int index)
+{
+    GG_TABBAR_PROFILE(SignalForwarding);
+    //An update does this bookkeeping once, when it ends.
+    if( this->isUpdating() ) { return; }
+
+    if( index >= 0 ) {
+        m_tabRecency.touch(this->tabId(index));
+    }
+    this->showCurrentPage();
+    if( m_bCoalescedNotifications ) {
+        this->queueTabsChanged();
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+void
+GGTabBarWidget::setMaximumClosedTabs(int count)
+{
+    m_iMaxClosedTabs = qMax(0, count);
+    this->trimClosedTabs();
+}
+
+void
+GGTabBarWidget::setMaximumClosedTabBytes(qint64 bytes)
+{
+    m_iMaxClosedTabBytes = qMax(qint64(0), bytes);
+    this->trimClosedTabs();
+}
+
+void
+GGTabBarWidget::clearClosedTabs()
+{
+    m_lClosedTabs.clear();
+    m_iClosedTabBytes = 0;
+}
+
+/* Removes the tab, keeping it to be reopened. */
+void
+GGTabBarWidget::closeTab(int index)
+{
+    if( index < 0 || index >= this->count() ) { return; }
+
+    this->keepClosedTab(index);
+    this->removeTab(index);
+}
+
+/*
+ * The tab is inserted at its former index, or last if there are fewer tabs now, and becomes
+ * current. Its page is built again from the kept state once shown.
+ */
+int
+GGTabBarWidget::reopenLastClosed()
+{
+    if( m_lClosedTabs.isEmpty() || this->model() ) { return -1; }
+
+    ClosedTab tab = m_lClosedTabs.takeLast();
+    m_iClosedTabBytes -= tab.bytes;
+
+    int index = this->insertTab(qMin(tab.index, this->count()), tab.icon, tab.text);
+    if( !tab.iconSource.isEmpty() ) {
+        this->setTabIconSource(index, tab.iconSource);
+    }
+    if( tab.data.isValid() ) {
+        this->setTabData(index, tab.data);
+    }
+#ifndef QT_NO_TOOLTIP
+    if( !tab.toolTip.isEmpty() ) {
+        this->setTabToolTip(index, tab.toolTip);
+    }
+#endif
+    if( tab.textColor.isValid() ) {
+        this->setTabTextColor(index, tab.textColor);
+    }
+    if( !tab.pageState.isEmpty() ) {
+        this->setPageState(this->tabId(index), tab.pageState);
+    }
+    this->setCurrentIndex(index);
+    return index;
+}
+
+/*
+ * Called before the tab is removed. A loaded page is asked for its state, so the cost of the
+ * page saver is only paid when the tab is kept.
+ * The size of the icon is estimated from iconSize(): icons are shared with the tab bar and
+ * pixmaps of other sizes may be cached in them.
+ */
+void
+GGTabBarWidget::keepClosedTab(int index)
+{
+    if( 0 == m_iMaxClosedTabs || this->model() ) { return; }
+
+    quint64 id = this->tabId(index);
+    ClosedTab tab;
+    tab.index = index;
+    tab.text = this->tabText(index);
+    tab.iconSource = this->tabIconSource(index);
+    if( tab.iconSource.isEmpty() ) {
+        tab.icon = this->tabIcon(index);
+    }
+    tab.data = this->tabData(index);
+#ifndef QT_NO_TOOLTIP
+    tab.toolTip = this->tabToolTip(index);
+#endif
+    tab.textColor = this->tabTextColor(index);
+    this->destroyPage(id, true);
+    tab.pageState = m_hashPageStates.take(id);
+
+    tab.bytes = sizeof(ClosedTab) + tab.pageState.size()
+              + (tab.text.size() + tab.iconSource.size() + tab.toolTip.size()) * sizeof(QChar);
+    if( !tab.icon.isNull() ) {
+        tab.bytes += this->iconSize().width() * this->iconSize().height() * 4;
+    }
+    if( QVariant::String == tab.data.type() ) {
+        tab.bytes += tab.data.toString().size() * sizeof(QChar);
+    } else if( QVariant::ByteArray == tab.data.type() ) {
+        tab.bytes += tab.data.toByteArray().size();
+    }
+
+    m_lClosedTabs.append(tab);
+    m_iClosedTabBytes += tab.bytes;
+    this->trimClosedTabs();
+}
+
+/* Drops the oldest closed tabs first. */
+void
+GGTabBarWidget::trimClosedTabs()
+{
+    while( !m_lClosedTabs.isEmpty()
+           && (m_lClosedTabs.size() > m_iMaxClosedTabs
+               || (m_iMaxClosedTabBytes > 0 && m_iClosedTabBytes > m_iMaxClosedTabBytes)) ) {
+        m_iClosedTabBytes -= m_lClosedTabs.takeFirst().bytes;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+void
+GGTabBarWidget::setPageFactory(const PageFactory& factory)
+{
+    m_pageFactory = factory;
+    if( !m_pPageStack ) {
+        m_pPageStack = new QStackedWidget(this);
+        m_pLayout->addWidget(m_pPageStack, 1);
+    }
+    this->showCurrentPage();
+}
+
+void
+GGTabBarWidget::setMaximumLoadedPages(int count)
+{
+    m_iMaxLoadedPages = qMax(1, count);
+    this->unloadPages();
+}
+
+void
+GGTabBarWidget::setMaximumLoadedPageCost(qint64 cost)
+{
+    m_iMaxLoadedPageCost = qMax<qint64>(0, cost);
+    this->unloadPages();
+}
+
+bool
+GGTabBarWidget::unloadPage(quint64 id)
+{
+    int index = this->currentIndex();
+    if( !m_hashPages.contains(id) || (index >= 0 && id == this->tabId(index)) ) {
+        return false;
+    }
+    this->destroyPage(id, true);
+    return true;
+}
+
+QByteArray
+GGTabBarWidget::saveSession() const
+{
+    return GGTabSession::save(this);
+}
+
+bool
+GGTabBarWidget::restoreSession(const QByteArray& session)
+{
+    return GGTabSession::restore(this, session);
+}
+
+/*
+ * Builds the page of the current tab if it is not loaded, from its saved state if any.
+ * In a beginUpdate()/endUpdate() batch, waits for tabsChanged() so that the pages of the tabs
+ * that are only current in the middle of the batch are never built.
+ */
+void
+GGTabBarWidget::showCurrentPage()
+{
+    if( !m_pageFactory || this->isUpdating() ) { return; }
+
+    int index = this->currentIndex();
+    if( index < 0 ) { return; }
+
+    quint64 id = this->tabId(index);
+    QWidget* pPage = m_hashPages.value(id, nullptr);
+    if( !pPage ) {
+        pPage = m_pageFactory(id, m_hashPageStates.take(id));
+        if( !pPage ) { return; }
+
+        qint64 cost = m_pageCost ? m_pageCost(id, pPage) : 0;
+        m_hashPages.insert(id, pPage);
+        m_hashPageCosts.insert(id, cost);
+        m_iLoadedPageCost += cost;
+        m_pPageStack->addWidget(pPage);
+        emit pageLoaded(id, pPage);
+    }
+    m_pageRecency.touch(id);
+    m_pPageStack->setCurrentWidget(pPage);
+    this->unloadPages();
+}
+
+/* The most recent page is the one shown, and is never unloaded. */
+void
+GGTabBarWidget::unloadPages()
+{
+    while( m_pageRecency.size() > 1
+           && (m_pageRecency.size() > m_iMaxLoadedPages
+               || (m_iMaxLoadedPageCost > 0 && m_iLoadedPageCost > m_iMaxLoadedPageCost)) ) {
+        this->destroyPage(m_pageRecency.leastRecent(), true);
+    }
+}
+
+void
+GGTabBarWidget::destroyPage(quint64 id, bool bSave)
 {
-    int tabIndex = pAction->data().toInt();
-    m_pScrollableTabBar->setCurrentIndex(tabIndex);
+    QWidget* pPage = m_hashPages.take(id);
+    if( !pPage ) { return; }
+
+    m_pageRecency.remove(id);
+    m_iLoadedPageCost -= m_hashPageCosts.take(id);
+    if( bSave && m_pageSaver ) {
+        QByteArray state = m_pageSaver(id, pPage);
+        if( !state.isEmpty() ) {
+            m_hashPageStates.insert(id, state);
+        }
+    }
+    m_pPageStack->removeWidget(pPage);
+    pPage->hide();
+    pPage->deleteLater(); //The page may be the sender of the signal being handled.
+    emit pageUnloaded(id);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -1,15 +1,56 @@
 #ifndef GGTABBAR_H
 #define GGTABBAR_H
 
+#include <QAbstractItemModel>
+#include <QCache>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
 #include <QScrollArea>
+#include <QSet>
+#include <QStringList>
 #include <QTabBar>
+#include <QTimer>
 #include <QToolButton>
 #include <QVariant>
+#include <QVector>
 #include <QLineEdit>
 
+#include <functional>
+
+#include "GGInternPool.h"
+#include "GGRecencyList.h"
+
+class QShortcut;
+class QStackedWidget;
+class QStyleOptionTab;
+class QStylePainter;
+class QVBoxLayout;
+class GGTabMenuModel;
+class GGTabMenuPopup;
+class GGTabSwitcherPopup;
+class GGTabUpdateQueue;
+
 /* ------------------------------------------------------------------------- */
 
-#define GG_TABBAR_MAX_SCROLL_SPEED 15
+#define GG_TABBAR_MAX_SCROLL_SPEED 15 //Pixels per frame.
+#define GG_TABBAR_DEFAULT_MAX_SCROLL_SPEED (GG_TABBAR_MAX_SCROLL_SPEED * 60) //Pixels per second.
+#define GG_TABBAR_DEFAULT_SCROLL_ACCELERATION 4000 //Pixels per second, per second.
+#define GG_TABBAR_AUTOSCROLL_GAIN 30 //Pixels per second, per pixel past the edge.
+#define GG_TABBAR_AUTOSCROLL_INTERVAL 16
+#define GG_TABBAR_DEFAULT_UNIFORM_TAB_WIDTH 160
+#define GG_TABBAR_DEFAULT_OVERSCAN 4
+#define GG_TABBAR_DEFAULT_INDICATOR_RATE 30
+#define GG_TABBAR_PARALLEL_MEASURE_MIN_TABS 256 //Smaller bulk insertions measure their texts on the GUI thread.
+#define GG_TABBAR_MEASURE_CHUNK_SIZE 64
+#define GG_TABBAR_DEFAULT_TAB_PIXMAP_BUDGET (8 * 1024 * 1024) //Bytes.
+#define GG_TABBAR_TAB_PIXMAP_MARGIN 4 //Pixels around the tab, for styles drawing past its rect.
+#define GG_TABBAR_DRAG_SETTLE_DELAY 100 //Milliseconds without repaint after a drop before using the pixmap cache again.
+#define GG_TABBAR_DEFAULT_MAX_LOADED_PAGES 16
+#define GG_TABBAR_DEFAULT_TAB_SWITCHER_SIZE 10
+#define GG_TABBAR_DEFAULT_MAX_CLOSED_TABS 20
+#define GG_TABBAR_DEFAULT_MAX_CLOSED_TAB_BYTES (4 * 1024 * 1024)
 
 /* ------------------------------------------------------------------------- */
 
@@ -18,11 +59,30 @@
  * Its default tabsClosable value is true.
  *
  * It also provides a isDragging() method to know if a tab is currently being dragged.
+ *
+ * Each tab has a stable tabId(), kept when tabs are moved, inserted or removed. Tabs must be
+ * changed through GGTabBar, not a QTabBar pointer, for tabAdded(), tabAboutToBeRemoved() and
+ * tabTextChanged() to be emitted.
+ *
+ * Changes made between beginUpdate() and endUpdate(), or by the bulk methods, are painted and
+ * laid out once the outermost endUpdate() is reached, which emits tabsChanged().
+ *
+ * See the README for the virtualized mode, the caches, the indicators, the icon sources,
+ * inline renaming, the model and the compact storage.
  */
 class GGTabBar : public QTabBar
 {
     Q_OBJECT
 public:
+    enum TabRole {
+        TextRole,       //Qt::DisplayRole by default.
+        IconRole,       //Qt::DecorationRole by default.
+        ToolTipRole,    //Qt::ToolTipRole by default.
+        TextColorRole,  //Qt::ForegroundRole by default, a QColor or a QBrush.
+        DataRole,       //Qt::UserRole by default.
+        TabRoleCount
+    };
+
     GGTabBar(QWidget* parent = nullptr);
     ~GGTabBar();
 
@@ -30,48 +90,364 @@ public:
     inline bool renameOnDoubleClick() { return m_bRenameOnDoubleClick; }
     inline void setRenameOnDoubleClick(bool b) { m_bRenameOnDoubleClick = b; }
 
+    //Returns false to reject text, which may also be modified.
+    typedef std::function<bool(int index, QString& text)> RenameValidator;
+    inline void setRenameValidator(const RenameValidator& validator) { m_renameValidator = validator; }
+    void startRename(int index);
+    inline bool isRenaming() const { return 0 != m_iEditedTabId; }
+    inline int renamedTab() const { return this->tabIndex(m_iEditedTabId); }
+    bool commitRename(); //Returns false if the text is rejected.
+    void cancelRename();
+    bool renameTabs(const QHash<quint64, QString>& texts); //By tabId().
+
+    int addTab(const QString& text);
+    int addTab(const QIcon& icon, const QString& text);
+    int insertTab(int index, const QString& text);
+    int insertTab(int index, const QIcon& icon, const QString& text);
+    void removeTab(int index);
+    void setTabText(int index, const QString& text);
+    void setTabIcon(int index, const QIcon& icon); //Drops the icon source of the tab.
+    void setIconSize(const QSize& size);
+
+    void setTabIconSource(int index, const QString& source);
+    inline QString tabIconSource(int index) const { return m_hashIconSources.value(this->tabId(index)); }
+    QIcon iconPlaceholder() const;
+    void setIconPlaceholder(const QIcon& icon);
+
+    inline quint64 tabId(int index) const { return index >= 0 && index < m_lTabIds.size() ? m_lTabIds.at(index) : 0; }
+    int tabIndex(quint64 id) const;
+
+    inline bool isVirtualized() const { return m_bVirtualized; }
+    void setVirtualized(bool b);
+    inline int uniformTabWidth() const { return m_iUniformTabWidth; }
+    void setUniformTabWidth(int width);
+    inline int overscan() const { return m_iOverscan; }
+    void setOverscan(int tabs);
+
+    void setViewportRect(const QRect& r); //Visible part of the tab bar, in its own coordinates.
+    inline QRect viewportRect() const { return m_viewportRect.isValid() ? m_viewportRect : this->rect(); }
+    int firstVisibleTab() const;
+    int lastVisibleTab() const;
+
+    int tabAt(const QPoint& pos) const;
+
+    inline bool tabsClosable() const { return m_bTabsClosable; }
+    void setTabsClosable(bool closable);
+
+    void beginUpdate();
+    void endUpdate();
+    inline bool isUpdating() const { return m_iUpdateDepth > 0; }
+    int addTabs(const QStringList& texts);
+    int insertTabs(int index, const QStringList& texts);
+    void removeTabs(int index, int count);
+    int removeIf(const std::function<bool(int)>& predicate);
+
+    void setModel(QAbstractItemModel* pModel, int column = 0);
+    inline QAbstractItemModel* model() const { return m_pModel; }
+    inline int modelColumn() const { return m_iModelColumn; }
+    inline int roleMapping(TabRole role) const { return m_aModelRoles[role]; }
+    void setRoleMapping(TabRole role, int itemRole);
+
+    void setTabProgress(int index, int value);
+    int tabProgress(int index) const;
+    void setTabBadge(int index, int count);
+    int tabBadge(int index) const;
+    inline int indicatorRate() const { return m_iIndicatorRate; }
+    void setIndicatorRate(int hz);
+
+    inline quint64 sizeHintCacheHits() const { return m_iSizeHintHits; }
+    inline quint64 sizeHintCacheMisses() const { return m_iSizeHintMisses; }
+    inline void resetSizeHintCacheStats() { m_iSizeHintHits = m_iSizeHintMisses = 0; }
+    void clearSizeHintCache();
+
+    inline bool isTabPixmapCacheEnabled() const { return m_bTabPixmapCacheEnabled; }
+    void setTabPixmapCacheEnabled(bool b);
+    inline int tabPixmapCacheBudget() const { return m_tabPixmaps.maxCost(); }
+    inline void setTabPixmapCacheBudget(int bytes) { m_tabPixmaps.setMaxCost(qMax(0, bytes)); }
+    inline int tabPixmapCacheBytes() const { return m_tabPixmaps.totalCost(); }
+    inline quint64 tabPixmapCacheHits() const { return m_iTabPixmapHits; }
+    inline quint64 tabPixmapCacheMisses() const { return m_iTabPixmapMisses; }
+    inline void resetTabPixmapCacheStats() { m_iTabPixmapHits = m_iTabPixmapMisses = 0; }
+    inline void clearTabPixmapCache() { m_tabPixmaps.clear(); }
+
+    inline bool isCompactStorage() const { return m_bCompactStorage; }
+    void setCompactStorage(bool b);
+    qint64 tabMetadataBytes() const; //O(count()) outside of compact storage.
+    inline qint64 tabMetadataBytesPerTab() const { return this->count() > 0 ? this->tabMetadataBytes() / this->count() : 0; }
+
+    void setTabData(int index, const QVariant& data);
+    QVariant tabData(int index) const;
+#ifndef QT_NO_TOOLTIP
+    void setTabToolTip(int index, const QString& tip);
+    QString tabToolTip(int index) const;
+#endif
+#ifndef QT_NO_WHATSTHIS
+    void setTabWhatsThis(int index, const QString& text);
+    QString tabWhatsThis(int index) const;
+#endif
+
 signals:
     void tabDoubleClicked(int);
+    void updateStarted();
+    void tabsChanged();
+    void tabAdded(int index);
+    void tabAboutToBeRemoved(int index);
+    void tabTextChanged(int index);
+    void renameCanceled(int index);
 
 protected:
+    virtual bool event                  (QEvent* e);
+    virtual bool eventFilter            (QObject* o, QEvent* e);
+    virtual void tabInserted            (int index);
+    virtual void tabRemoved             (int index);
+    virtual QSize tabSizeHint           (int index) const;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+    virtual QSize minimumTabSizeHint    (int index) const;
+#endif
+    virtual void tabLayoutChange        ();
+    virtual void changeEvent            (QEvent* e);
+    virtual void paintEvent             (QPaintEvent* e);
     virtual void mousePressEvent        (QMouseEvent* e);
     virtual void mouseMoveEvent         (QMouseEvent* e);
     virtual void mouseReleaseEvent      (QMouseEvent* e);
     virtual void mouseDoubleClickEvent  (QMouseEvent* e);
 
 private:
-    void startRename(int);
+    void updateRenameEditorGeometry();
+    int tabAtOffset(int offset) const;
+    int axisOffset(const QPoint& pos) const;
+    void setTabButtonsVisible(int index, bool bVisible);
+    QSize reserveCloseButton(int index, QSize hint) const;
+    void relayoutTabs();
+    QSize cachedTabSizeHint(int index, bool bMinimum) const;
+    void checkSizeHintKey() const;
+    void measureTexts(const QStringList& texts);
+    quint64 tabHintConfig(int index) const;
+    QSize measureTabSizeHint(int index) const;
+    void paintVisibleTabs(QPaintEvent* e);
+    void paintTab(QStylePainter& p, QStyleOptionTab& opt, int index);
+    void paintIndicators(QPaintEvent* e);
+    int badgeWidth(int count) const;
+    void scheduleIndicatorUpdate(quint64 id);
+    void insertModelTabs(int first, int last);
+    void updateTabFromModel(int index, bool bText, bool bIcon, bool bTextColor);
+    QVariant modelData(int index, TabRole role) const;
+    bool moveModelRow(int from, int to);
+    void loadTabIcon(int index, const QString& source);
+    void reloadTabIcons();
+    void removeIconSource(quint64 id);
+    quint32 internString(const QString& string);
+    quint32 internIcon(const QIcon& icon);
+    void insertRecord(int index, quint32 text, quint32 icon);
+    void removeRecord(int index);
 
 private:
     QLineEdit * m_pTabNameEdit;
-    int m_iEditedTabIndex;
+    quint64 m_iEditedTabId;
+    RenameValidator m_renameValidator;
     bool m_bDragging;
     bool m_bRenameOnDoubleClick;
 
+    QVector<quint64> m_lTabIds;
+    quint64 m_iNextTabId;
+    bool m_bTabIdInserted;
+    bool m_bTabIdRemoved;
+    mutable QHash<quint64, int> m_hashTabIndexes;
+    mutable bool m_bTabIndexesDirty;
+
+    bool m_bVirtualized;
+    int m_iUniformTabWidth;
+    mutable int m_iUniformTabThickness;
+    int m_iOverscan;
+    int m_iButtonsFirst;
+    int m_iButtonsLast;
+    bool m_bUpdatingButtons;
+    bool m_bButtonsRestricted;
+    bool m_bButtonsSyncPending;
+    QRect m_viewportRect;
+
+    bool m_bTabsClosable;
+    QSet<QObject*> m_setCloseButtons;
+    QList<QWidget*> m_lSpareCloseButtons;
+    QSet<quint64> m_setPendingCloseButtons; //Ids of the tabs waiting for their close button.
+
+    int m_iUpdateDepth;
+    quint64 m_iUpdateCurrentId;     //Current tab when the update began.
+    bool m_bUpdatesWereEnabled;
+
+    struct SizeHintKey {
+        QSize iconSize;
+        const QStyle* pStyle;
+        qreal devicePixelRatio;
+        int elideMode;
+        int shape;
+        bool bDocumentMode;
+        bool bTabsClosable;
+        bool operator==(const SizeHintKey& o) const {
+            return iconSize == o.iconSize && pStyle == o.pStyle && devicePixelRatio == o.devicePixelRatio
+                && elideMode == o.elideMode && shape == o.shape && bDocumentMode == o.bDocumentMode
+                && bTabsClosable == o.bTabsClosable;
+        }
+    };
+    struct SizeHintEntry {
+        SizeHintEntry() : bHasIcon(false), pLeftButton(nullptr), pRightButton(nullptr) {}
+        QString text;
+        bool bHasIcon;          //QTabBar sizes any icon to iconSize().
+        const QWidget* pLeftButton;
+        const QWidget* pRightButton;
+        QSize hint;
+        QSize minimumHint;
+    };
+    mutable SizeHintKey m_sizeHintKey;
+    mutable QHash<quint64, SizeHintEntry> m_hashSizeHints;
+    mutable bool m_bMeasuringTab;
+    mutable quint64 m_iSizeHintHits;
+    mutable quint64 m_iSizeHintMisses;
+
+    struct TabHintModel {
+        TabHintModel() : base(0), thickness(0), samples(0), bLinear(true) {}
+        int base;       //Length of the tab minus the width of its text.
+        int thickness;
+        int samples;
+        bool bLinear;
+    };
+    mutable QHash<QString, int> m_hashTextWidths;
+    mutable QHash<quint64, TabHintModel> m_hashTabHintModels; //By tabHintConfig().
+
+    struct TabIndicators {
+        TabIndicators() : progress(-1), badge(0) {}
+        int progress;
+        int badge;
+    };
+    QHash<quint64, TabIndicators> m_hashIndicators;
+    QSet<quint64> m_setDirtyIndicators;
+    bool m_bBadgeRelayoutPending;   //A badge changed width since the last flushIndicators().
+    QTimer m_indicatorTimer;
+    QElapsedTimer m_lastIndicatorFlush;
+    int m_iIndicatorRate;
+
+    QAbstractItemModel* m_pModel;
+    int m_iModelColumn;
+    int m_aModelRoles[TabRoleCount];
+    bool m_bSyncingFromModel;
+    bool m_bWritingToModel;
+    int m_iRemovedRowsFirst;
+    QVector<QVariant> m_lRemovedRowsData;    //Data and tool tips of the rows being removed, whose
+    QStringList m_lRemovedRowsToolTips;      //tabs are only removed once the model has removed them.
+
+    QHash<quint64, QString> m_hashIconSources;
+    QMultiHash<QString, quint64> m_hashIconSourceTabs;
+    QIcon m_iconPlaceholder;
+    mutable QIcon m_iconStylePlaceholder;   //Shared by the tabs, until the style changes.
+    bool m_bIconCacheConnected;
+
+    //Handles in m_stringPool and m_iconPool (0 for none) in tab order, filled in compact storage only.
+    struct TabRecords {
+        QVector<quint32> texts;
+        QVector<quint32> icons;
+        QVector<quint32> toolTips;
+        QVector<quint32> whatsThis;
+        QVector<quint32> data;      //Only for QString data.
+    };
+    bool m_bCompactStorage;
+    TabRecords m_records;
+    GGInternPool<QString, QString> m_stringPool;
+    GGInternPool<QString, QIcon> m_iconPool;
+
+    struct TabPixmapKey {
+        quint64 id;
+        uint state;
+        int position;
+        int selectedPosition;
+        QSize size;
+        bool operator==(const TabPixmapKey& o) const {
+            return id == o.id && state == o.state && position == o.position
+                && selectedPosition == o.selectedPosition && size == o.size;
+        }
+        friend inline uint qHash(const TabPixmapKey& key, uint seed = 0) {
+            return qHash(key.id, seed) ^ (key.state << 8) ^ uint(key.position * 7 + key.selectedPosition)
+                 ^ uint(key.size.width() * 31 + key.size.height());
+        }
+    };
+    struct TabPixmapEntry {
+        QString text;
+        qint64 iconKey;
+        QRgb textColor;
+        QSize leftButtonSize;
+        QSize rightButtonSize;
+        QPixmap pixmap;
+    };
+    SizeHintKey m_tabPixmapKey;
+    QCache<TabPixmapKey, TabPixmapEntry> m_tabPixmaps;
+    bool m_bTabPixmapCacheEnabled;
+    quint64 m_iTabPixmapHits;
+    quint64 m_iTabPixmapMisses;
+
+    QPoint m_pressPos;
+    bool m_bTabDragged;             //From the start of a drag until the tabs settle after the drop.
+    QTimer m_dragSettleTimer;
+
 
 private slots:
     void finishRename();
+    void onTabMoved(int from, int to);
+    void updateVisibleTabButtons(bool bFull = true);
+    void onCloseButtonClicked();
+    void onCloseButtonDestroyed(QObject* pButton);
+    void flushIndicators();
+    void onDragSettled();
+    void onModelRowsInserted(const QModelIndex& parent, int first, int last);
+    void onModelRowsAboutToBeRemoved(const QModelIndex& parent, int first, int last);
+    void onModelRowsRemoved(const QModelIndex& parent, int first, int last);
+    void onModelRowsMoved(const QModelIndex& parent, int start, int end, const QModelIndex& destination, int row);
+    void onModelDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles);
+    void onModelReset();
+    void onModelDestroyed();
+    void onIconReady(const QString& source, const QSize& size, qreal devicePixelRatio, const QPixmap& pixmap);
 };
 
 /**
  * Scrollable Tab Bar is a "scrollable" GGTabBar.
  * Its tabs are movable and when moving a tab outside of the TabBar, the tabBar is scrolled.
+ * The scrolling runs on a timer for as long as the tab is held past an edge, even if the mouse
+ * does not move: its speed grows with the distance to the edge, up to maximumScrollSpeed(),
+ * at the rate of scrollAcceleration().
  *
  * The height of the GGScrollableTabBar is automatically adjusted to its content.
  * Therefore, it will not be displayed when there is no tab.
  *
  * When focusing a tab, the GGScrollableTabBar will automatically scroll to make it visible.
+ * The height adjustments and scrolls requested during an event loop iteration are merged,
+ * and done once when control returns to the event loop.
  *
  * The methods of GGTabBar are directly accessible through GGScrollableTabBar.
+ * Positions and rects (tabAt(), tabRect()) are expressed in the GGTabBar coordinates.
  */
 class GGScrollableTabBar : public QScrollArea
 {
     Q_OBJECT
+    Q_PROPERTY(int maximumScrollSpeed READ maximumScrollSpeed WRITE setMaximumScrollSpeed)
+    Q_PROPERTY(int scrollAcceleration READ scrollAcceleration WRITE setScrollAcceleration)
 
 public:
     GGScrollableTabBar(QWidget* parent = nullptr);
     ~GGScrollableTabBar();
 
+    inline GGTabBar* tabBar() const { return m_pTabBar; }
+
+    inline int maximumScrollSpeed() const { return m_iMaxScrollSpeed; }
+    inline void setMaximumScrollSpeed(int pixelsPerSecond) { m_iMaxScrollSpeed = qMax(1, pixelsPerSecond); }
+    inline int scrollAcceleration() const { return m_iScrollAcceleration; }
+    inline void setScrollAcceleration(int pixelsPerSecond2) { m_iScrollAcceleration = qMax(1, pixelsPerSecond2); }
+
+    inline quint64 pendingRequestCount() const { return m_iPendingRequests; }
+    inline quint64 mergedRequestCount() const { return m_iMergedRequests; }
+    inline quint64 pendingFlushCount() const { return m_iPendingFlushes; }
+    inline void resetPendingStats() { m_iPendingRequests = m_iMergedRequests = m_iPendingFlushes = 0; }
+
+    int scrollOffset() const;
+    void setScrollOffset(int offset);
+
     bool blockSignals(bool block); //Also blocks the GGTabBar signals.
     
     inline int addTab(const QString& text) { return m_pTabBar->addTab(text); }
@@ -98,9 +474,13 @@ public:
     inline void setTabData(int index, const QVariant& data) { m_pTabBar->setTabData(index, data); }
     inline void setTabEnabled(int index, bool bEnabled) { m_pTabBar->setTabEnabled(index, bEnabled); }
     inline void setTabIcon(int index, const QIcon &icon) { m_pTabBar->setTabIcon(index, icon); }
+    inline void setTabIconSource(int index, const QString& source) { m_pTabBar->setTabIconSource(index, source); }
+    inline QString tabIconSource(int index) const { return m_pTabBar->tabIconSource(index); }
+    inline QIcon iconPlaceholder() const { return m_pTabBar->iconPlaceholder(); }
+    inline void setIconPlaceholder(const QIcon& icon) { m_pTabBar->setIconPlaceholder(icon); }
     inline void setTabText(int index, const QString&  text) { m_pTabBar->setTabText(index, text); }
     inline void setTabTextColor(int index, const QColor &color) { m_pTabBar->setTabTextColor(index, color); }
-    inline int tabAt(const QPoint &pos) const;
+    inline int tabAt(const QPoint &pos) const { return m_pTabBar->tabAt(pos); }
     inline QWidget* tabButton(int index, QTabBar::ButtonPosition position) const { return m_pTabBar->tabButton(index, position); }
     inline bool tabsClosable() const { return m_pTabBar->tabsClosable(); }
     inline QVariant tabData(int index) const { return m_pTabBar->tabData(index); }
@@ -109,6 +489,36 @@ public:
     inline QString tabText(int index) const { return m_pTabBar->tabText(index); }
     inline QColor tabTextColor(int index) const { return m_pTabBar->tabTextColor(index); }
 
+    inline bool isVirtualized() const { return m_pTabBar->isVirtualized(); }
+    inline void setVirtualized(bool b) { m_pTabBar->setVirtualized(b); }
+    inline int uniformTabWidth() const { return m_pTabBar->uniformTabWidth(); }
+    inline void setUniformTabWidth(int width) { m_pTabBar->setUniformTabWidth(width); }
+    inline int overscan() const { return m_pTabBar->overscan(); }
+    inline void setOverscan(int tabs) { m_pTabBar->setOverscan(tabs); }
+
+    inline quint64 tabId(int index) const { return m_pTabBar->tabId(index); }
+    inline int tabIndex(quint64 id) const { return m_pTabBar->tabIndex(id); }
+
+    inline void beginUpdate() { m_pTabBar->beginUpdate(); }
+    inline void endUpdate() { m_pTabBar->endUpdate(); }
+    inline bool isUpdating() const { return m_pTabBar->isUpdating(); }
+    inline int addTabs(const QStringList& texts) { return m_pTabBar->addTabs(texts); }
+    inline int insertTabs(int index, const QStringList& texts) { return m_pTabBar->insertTabs(index, texts); }
+    inline void removeTabs(int index, int count) { m_pTabBar->removeTabs(index, count); }
+    inline int removeIf(const std::function<bool(int)>& predicate) { return m_pTabBar->removeIf(predicate); }
+    inline bool renameTabs(const QHash<quint64, QString>& texts) { return m_pTabBar->renameTabs(texts); }
+
+    inline bool isCompactStorage() const { return m_pTabBar->isCompactStorage(); }
+    inline void setCompactStorage(bool b) { m_pTabBar->setCompactStorage(b); }
+    inline qint64 tabMetadataBytes() const { return m_pTabBar->tabMetadataBytes(); }
+    inline qint64 tabMetadataBytesPerTab() const { return m_pTabBar->tabMetadataBytesPerTab(); }
+
+    inline void setModel(QAbstractItemModel* pModel, int column = 0) { m_pTabBar->setModel(pModel, column); }
+    inline QAbstractItemModel* model() const { return m_pTabBar->model(); }
+    inline int modelColumn() const { return m_pTabBar->modelColumn(); }
+    inline int roleMapping(GGTabBar::TabRole role) const { return m_pTabBar->roleMapping(role); }
+    inline void setRoleMapping(GGTabBar::TabRole role, int itemRole) { m_pTabBar->setRoleMapping(role, itemRole); }
+
 #ifndef QT_NO_TOOLTIP
     inline void setTabToolTip(int index, const QString &tip) { m_pTabBar->setTabToolTip(index, tip); }
     inline QString tabToolTip(int index) const { return m_pTabBar->tabToolTip(index); }
@@ -125,6 +535,10 @@ signals:
     void tabMoved(int from, int to);
     void tabBarClicked(int index);
     void tabBarDoubleClicked(int index);
+    void tabsChanged();
+    void tabAdded(int index);
+    void tabAboutToBeRemoved(int index);
+    void tabTextChanged(int index);
 
 public slots:
     inline void setCurrentIndex(int index) { m_pTabBar->setCurrentIndex(index); }
@@ -136,29 +550,56 @@ protected:
     virtual void resizeEvent        (QResizeEvent* e);
 
 protected slots:
-    inline void makeCurrentVisible() { this->makeVisible(m_pTabBar->currentIndex()); }
+    inline void makeCurrentVisible() { this->requestPendingUpdate(PendingVisibility); }
     void makeVisible(int index);
     void adjustHeight();
-    inline void onCurrentChanged    (int index) { makeVisible(index); emit currentChanged(index); }
-    inline void onTabCloseRequested (int index) { emit tabCloseRequested(index); }
-    inline void onTabMoved          (int from, int to) { emit tabMoved(from, to); }
-    inline void onTabBarClicked     (int index) { emit tabBarClicked(index); }
-    inline void onTabBarDoubleClicked(int index) { emit tabBarDoubleClicked(index); }
+    void flushPendingUpdates();
+    void updateViewportRect();
+    void onUpdateStarted            ();
+    void onTabsChanged              ();
+    void autoScroll                 ();
 
 private:
+    enum PendingUpdate {
+        PendingHeight       = 0x1,
+        PendingVisibility   = 0x2,
+        PendingScroll       = 0x4
+    };
+
     void scroll(int dx);
+    void stopAutoScroll();
+    void requestPendingUpdate(PendingUpdate update);
 
 private:
     GGTabBar*       m_pTabBar;
+
+    QTimer          m_autoScrollTimer;
+    QElapsedTimer   m_autoScrollClock;
+    int             m_iAutoScrollDistance; //Signed distance of the cursor past the nearest edge.
+    double          m_dAutoScrollVelocity;
+    double          m_dAutoScrollRemainder;
+    int             m_iMaxScrollSpeed;
+    int             m_iScrollAcceleration;
+
+    int             m_iPendingUpdates;
+    bool            m_bPendingFlushQueued;
+    quint64         m_iPendingRequests;
+    quint64         m_iMergedRequests;
+    quint64         m_iPendingFlushes;
+    int             m_iPendingScrollOffset; //-1 when none.
+    bool            m_bScrollOffsetRetried;
 };
 
 /**
  * GGTabBarWidget handles a GGScrollableTabBar and a button that displays a Menu
  * containing direct links to all the tabs when clicked.
- * The actions in the Menu are sorted by alphabetical order.
+ * The tabs in the Menu are sorted by alphabetical order, or by recency.
  *
  * By default, the button is not displayed when there is no tab.
  *
+ * See the README for the updates posted from other threads, the pages, the Ctrl+Tab switcher,
+ * the recently closed tabs and the coalesced notifications.
+ *
  * The methods of GGScrollableTabBar are directly accessible through GGTabBarWidget.
  */
 class GGTabBarWidget : public QWidget
@@ -196,9 +637,13 @@ public:
     inline void setTabData(int index, const QVariant& data) { m_pScrollableTabBar->setTabData(index, data); }
     inline void setTabEnabled(int index, bool bEnabled) { m_pScrollableTabBar->setTabEnabled(index, bEnabled); }
     inline void setTabIcon(int index, const QIcon &icon) { m_pScrollableTabBar->setTabIcon(index, icon); }
+    inline void setTabIconSource(int index, const QString& source) { m_pScrollableTabBar->setTabIconSource(index, source); }
+    inline QString tabIconSource(int index) const { return m_pScrollableTabBar->tabIconSource(index); }
+    inline QIcon iconPlaceholder() const { return m_pScrollableTabBar->iconPlaceholder(); }
+    inline void setIconPlaceholder(const QIcon& icon) { m_pScrollableTabBar->setIconPlaceholder(icon); }
     inline void setTabText(int index, const QString&  text) { m_pScrollableTabBar->setTabText(index, text); }
     inline void setTabTextColor(int index, const QColor &color) { m_pScrollableTabBar->setTabTextColor(index, color); }
-    inline int tabAt(const QPoint &pos) const;
+    inline int tabAt(const QPoint &pos) const { return m_pScrollableTabBar->tabAt(pos); }
     inline QWidget* tabButton(int index, QTabBar::ButtonPosition position) const { return m_pScrollableTabBar->tabButton(index, position); }
     inline bool tabsClosable() const { return m_pScrollableTabBar->tabsClosable(); }
     inline QVariant tabData(int index) const { return m_pScrollableTabBar->tabData(index); }
@@ -207,6 +652,99 @@ public:
     inline QString tabText(int index) const { return m_pScrollableTabBar->tabText(index); }
     inline QColor tabTextColor(int index) const { return m_pScrollableTabBar->tabTextColor(index); }
 
+    inline bool isVirtualized() const { return m_pScrollableTabBar->isVirtualized(); }
+    inline void setVirtualized(bool b) { m_pScrollableTabBar->setVirtualized(b); }
+    inline int uniformTabWidth() const { return m_pScrollableTabBar->uniformTabWidth(); }
+    inline void setUniformTabWidth(int width) { m_pScrollableTabBar->setUniformTabWidth(width); }
+    inline int overscan() const { return m_pScrollableTabBar->overscan(); }
+    inline void setOverscan(int tabs) { m_pScrollableTabBar->setOverscan(tabs); }
+    inline int maximumScrollSpeed() const { return m_pScrollableTabBar->maximumScrollSpeed(); }
+    inline void setMaximumScrollSpeed(int pixelsPerSecond) { m_pScrollableTabBar->setMaximumScrollSpeed(pixelsPerSecond); }
+    inline int scrollAcceleration() const { return m_pScrollableTabBar->scrollAcceleration(); }
+    inline void setScrollAcceleration(int pixelsPerSecond2) { m_pScrollableTabBar->setScrollAcceleration(pixelsPerSecond2); }
+    inline int scrollOffset() const { return m_pScrollableTabBar->scrollOffset(); }
+    inline void setScrollOffset(int offset) { m_pScrollableTabBar->setScrollOffset(offset); }
+
+    inline quint64 tabId(int index) const { return m_pScrollableTabBar->tabId(index); }
+    inline int tabIndex(quint64 id) const { return m_pScrollableTabBar->tabIndex(id); }
+
+    inline void beginUpdate() { m_pScrollableTabBar->beginUpdate(); }
+    inline void endUpdate() { m_pScrollableTabBar->endUpdate(); }
+    inline bool isUpdating() const { return m_pScrollableTabBar->isUpdating(); }
+    inline int addTabs(const QStringList& texts) { return m_pScrollableTabBar->addTabs(texts); }
+    inline int insertTabs(int index, const QStringList& texts) { return m_pScrollableTabBar->insertTabs(index, texts); }
+    inline void removeTabs(int index, int count) { m_pScrollableTabBar->removeTabs(index, count); }
+    inline int removeIf(const std::function<bool(int)>& predicate) { return m_pScrollableTabBar->removeIf(predicate); }
+    inline bool renameTabs(const QHash<quint64, QString>& texts) { return m_pScrollableTabBar->renameTabs(texts); }
+
+    inline bool isCompactStorage() const { return m_pScrollableTabBar->isCompactStorage(); }
+    inline void setCompactStorage(bool b) { m_pScrollableTabBar->setCompactStorage(b); }
+    inline qint64 tabMetadataBytes() const { return m_pScrollableTabBar->tabMetadataBytes(); }
+    inline qint64 tabMetadataBytesPerTab() const { return m_pScrollableTabBar->tabMetadataBytesPerTab(); }
+
+    //Thread-safe.
+    void postTabText(quint64 id, const QString& text);
+    void postTabTextColor(quint64 id, const QColor& color);
+    void postTabIcon(quint64 id, const QImage& icon);
+    inline GGTabUpdateQueue* updateQueue() const { return m_pUpdateQueue; }
+
+    inline void setModel(QAbstractItemModel* pModel, int column = 0) { m_pScrollableTabBar->setModel(pModel, column); }
+    inline QAbstractItemModel* model() const { return m_pScrollableTabBar->model(); }
+    inline int modelColumn() const { return m_pScrollableTabBar->modelColumn(); }
+    inline int roleMapping(GGTabBar::TabRole role) const { return m_pScrollableTabBar->roleMapping(role); }
+    inline void setRoleMapping(GGTabBar::TabRole role, int itemRole) { m_pScrollableTabBar->setRoleMapping(role, itemRole); }
+
+    //Builds the page of a tab, from the state returned by the page saver, empty the first time.
+    typedef std::function<QWidget*(quint64 id, const QByteArray& state)> PageFactory;
+    //Returns the state to rebuild an unloaded page from, or an empty QByteArray if there is none.
+    typedef std::function<QByteArray(quint64 id, QWidget* pPage)> PageSaver;
+    //Returns the cost of a loaded page, for instance an estimate of its memory use in bytes.
+    typedef std::function<qint64(quint64 id, QWidget* pPage)> PageCost;
+
+    void setPageFactory(const PageFactory& factory);
+    inline void setPageSaver(const PageSaver& saver) { m_pageSaver = saver; }
+    inline void setPageCost(const PageCost& cost) { m_pageCost = cost; } //Evaluated when a page is built.
+    inline QStackedWidget* pageStack() const { return m_pPageStack; }
+
+    inline QWidget* page(quint64 id) const { return m_hashPages.value(id, nullptr); }
+    inline bool isPageLoaded(quint64 id) const { return m_hashPages.contains(id); }
+    inline int loadedPageCount() const { return m_hashPages.size(); }
+    inline qint64 loadedPageCost() const { return m_iLoadedPageCost; }
+    inline int maximumLoadedPages() const { return m_iMaxLoadedPages; }
+    void setMaximumLoadedPages(int count);
+    inline qint64 maximumLoadedPageCost() const { return m_iMaxLoadedPageCost; }
+    void setMaximumLoadedPageCost(qint64 cost); //0 for no limit.
+
+    //The saved state of an unloaded page, used the next time it is built.
+    inline QByteArray pageState(quint64 id) const { return m_hashPageStates.value(id); }
+    inline void setPageState(quint64 id, const QByteArray& state) { m_hashPageStates.insert(id, state); }
+    bool unloadPage(quint64 id); //Does nothing for the page of the current tab.
+
+    QVector<quint64> recentTabs(int count = -1) const; //From the most recently current tab.
+    bool isMenuSortedByRecency() const;
+    void setMenuSortedByRecency(bool b);
+    inline int tabSwitcherSize() const { return m_iTabSwitcherSize; }
+    inline void setTabSwitcherSize(int tabs) { m_iTabSwitcherSize = qMax(2, tabs); }
+    bool isTabSwitcherEnabled() const;
+    void setTabSwitcherEnabled(bool b); //Enables the Ctrl+Tab shortcuts.
+
+    //Replaces currentChanged(), tabMoved() and the tab insertions and removals by a queued tabsChanged().
+    inline bool areNotificationsCoalesced() const { return m_bCoalescedNotifications; }
+    void setNotificationsCoalesced(bool b);
+
+    inline int closedTabCount() const { return m_lClosedTabs.size(); }
+    inline qint64 closedTabBytes() const { return m_iClosedTabBytes; } //Estimated.
+    inline QString lastClosedTabText() const { return m_lClosedTabs.isEmpty() ? QString() : m_lClosedTabs.last().text; }
+    inline int maximumClosedTabs() const { return m_iMaxClosedTabs; }
+    void setMaximumClosedTabs(int count); //0 to keep none.
+    inline qint64 maximumClosedTabBytes() const { return m_iMaxClosedTabBytes; }
+    void setMaximumClosedTabBytes(qint64 bytes);
+    void clearClosedTabs();
+
+    //See GGTabSession and GGTabSessionLoader, to save icons and restore the tabs incrementally.
+    QByteArray saveSession() const;
+    bool restoreSession(const QByteArray& session);
+
 #ifndef QT_NO_TOOLTIP
     inline void setTabToolTip(int index, const QString &tip) { m_pScrollableTabBar->setTabToolTip(index, tip); }
     inline QString tabToolTip(int index) const { return m_pScrollableTabBar->tabToolTip(index); }
@@ -223,22 +761,105 @@ signals:
     void tabMoved(int from, int to);
     void tabBarClicked(int index);
     void tabBarDoubleClicked(int index);
+    void tabsChanged();
+    void pageLoaded(quint64 id, QWidget* pPage);
+    void pageUnloaded(quint64 id);
 
 public slots:
     inline void setCurrentIndex(int index) { m_pScrollableTabBar->setCurrentIndex(index); }
+    inline void showTabSwitcher() { this->switchTab(false); }
+    inline void showTabSwitcherBackward() { this->switchTab(true); }
+    void closeTab(int index);
+    int reopenLastClosed(); //Returns the index of the reopened tab, -1 if there is none.
 
 protected slots:
     void displayMenu();
-    void onMenuAction(QAction* pAction);
-    inline void onCurrentChanged    (int index) { emit currentChanged(index); }
-    inline void onTabCloseRequested (int index) { emit tabCloseRequested(index); }
-    inline void onTabMoved          (int from, int to) { emit tabMoved(from, to); }
-    inline void onTabBarClicked     (int index) { emit tabBarClicked(index); }
-    inline void onTabBarDoubleClicked(int index) { emit tabBarDoubleClicked(index); }
+    void onMenuTabActivated(quint64 id);
+    void applyTabUpdates();
+    void onTabAdded(int index);
+    void onTabAboutToBeRemoved(int index);
+    void onTabTextChanged(int index);
+    void onTabsChanged();
+    void onCurrentChanged(int index);
+    void queueTabsChanged();
+    void emitQueuedTabsChanged();
+    void updateSignalForwarding();
+
+private:
+    struct ClosedTab {
+        int         index;
+        QString     text;
+        QIcon       icon;       //Only without icon source.
+        QString     iconSource;
+        QVariant    data;
+        QString     toolTip;
+        QColor      textColor;
+        QByteArray  pageState;
+        qint64      bytes;
+    };
+
+    void keepClosedTab(int index);
+    void trimClosedTabs();
+    void switchTab(bool bBackward);
+    void showCurrentPage();
+    void destroyPage(quint64 id, bool bSave);
+    void unloadPages();
 
 private:
     QToolButton*        m_pMenuButton;
     GGScrollableTabBar* m_pScrollableTabBar;
+    GGTabMenuModel*     m_pMenuModel;
+    GGTabMenuPopup*     m_pMenuPopup;
+    bool                m_bMenuDirty;
+    GGTabUpdateQueue*   m_pUpdateQueue;
+
+    GGRecencyList<quint64>      m_tabRecency;   //All the tabs, the current one first.
+    GGTabSwitcherPopup*         m_pSwitcherPopup;
+    QShortcut*                  m_pSwitcherShortcut;
+    QShortcut*                  m_pSwitcherBackShortcut;
+    int                         m_iTabSwitcherSize;
+
+    bool                        m_bCoalescedNotifications;
+    bool                        m_bTabsChangedQueued;
+
+    QList<ClosedTab>            m_lClosedTabs;  //The last closed one last.
+    qint64                      m_iClosedTabBytes;
+    int                         m_iMaxClosedTabs;
+    qint64                      m_iMaxClosedTabBytes;
+
+    QVBoxLayout*                m_pLayout;
+    QStackedWidget*             m_pPageStack;
+    PageFactory                 m_pageFactory;
+    PageSaver                   m_pageSaver;
+    PageCost                    m_pageCost;
+    QHash<quint64, QWidget*>    m_hashPages;
+    QHash<quint64, qint64>      m_hashPageCosts;
+    QHash<quint64, QByteArray>  m_hashPageStates;
+    GGRecencyList<quint64>      m_pageRecency;  //Loaded pages, the current one first.
+    qint64                      m_iLoadedPageCost;
+    int                         m_iMaxLoadedPages;
+    qint64                      m_iMaxLoadedPageCost;
+};
+
+/* ------------------------------------------------------------------------- */
+
+/**
+ * Calls beginUpdate() on construction and endUpdate() on destruction.
+ * Works with GGTabBar, GGScrollableTabBar and GGTabBarWidget.
+ */
+template<class TabBar>
+class GGTabBarUpdateGuard
+{
+public:
+    explicit GGTabBarUpdateGuard(TabBar* pTabBar) : m_pTabBar(pTabBar) { m_pTabBar->beginUpdate(); }
+    ~GGTabBarUpdateGuard() { m_pTabBar->endUpdate(); }
+
+private:
+    GGTabBarUpdateGuard(const GGTabBarUpdateGuard&);
+    GGTabBarUpdateGuard& operator=(const GGTabBarUpdateGuard&);
+
+private:
+    TabBar* m_pTabBar;
 };
 
 /* ------------------------------------------------------------------------- */
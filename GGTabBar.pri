@@ -0,0 +1,25 @@
+# Settings shared by the tab bar library and the applications using it.
+
+QT       += core gui
+CONFIG   += c++11
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+INCLUDEPATH += $$PWD
+DEPENDPATH  += $$PWD
+
+# Uncomment to record the timings of the tab bar operations (see GGTabBarProfiler).
+#DEFINES += GG_TABBAR_INSTRUMENTATION
+
+# Links the applications of this project to the library built in lib/.
+!equals(TEMPLATE, lib) {
+    win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../lib/release/ -lGGTabBar
+    else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../lib/debug/ -lGGTabBar
+    else:unix: LIBS += -L$$OUT_PWD/../lib/ -lGGTabBar
+
+    win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../lib/release/libGGTabBar.a
+    else:win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../lib/debug/libGGTabBar.a
+    else:win32:!win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../lib/release/GGTabBar.lib
+    else:win32:!win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../lib/debug/GGTabBar.lib
+    else:unix: PRE_TARGETDEPS += $$OUT_PWD/../lib/libGGTabBar.a
+}
@@ -4,20 +4,16 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
-CONFIG   += c++11
+# lib:   the tab bar classes, as a static library (see GGTabBar.pri).
+# demo:  the demo application.
+# bench: the headless benchmarks and randomized checker of the tab bar classes.
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+TEMPLATE = subdirs
 
-TARGET = GGTabBar
-TEMPLATE = app
+SUBDIRS = \
+        lib \
+        demo \
+        bench
 
-
-SOURCES += \
-        GGTabBar.cpp \
-        main.cpp\
-        mainwindow.cpp
-
-HEADERS  += \
-        GGTabBar.h \
-        mainwindow.h
+demo.depends = lib
+bench.depends = lib
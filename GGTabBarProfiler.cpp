@@ -0,0 +1,127 @@
+#include "GGTabBarProfiler.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+/* ------------------------------------------------------------------------- */
+
+static const char* const _operationNames[GGTabBarProfiler::OperationCount] = {
+    "paintEvent",
+    "tabSizeHint",
+    "layout",
+    "makeVisible",
+    "scroll",
+    "displayMenu",
+    "rename",
+    "signalForwarding",
+    "measureTexts"
+};
+
+/* Bucket i holds the durations from 2^i to 2^(i+1) microseconds, bucket 0 the shorter ones too. */
+static int
+_histogramBucket(qint64 durationNs)
+{
+    qint64 us = durationNs / 1000;
+    int bucket = 0;
+    while( us > 1 && bucket < GG_TABBAR_PROFILER_HISTOGRAM_BUCKETS - 1 ) {
+        us >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+/* ------------------------------------------------------------------------- */
+
+GGTabBarProfiler::GGTabBarProfiler()
+    : m_bEnabled(false)
+    , m_iTraceHead(0)
+{
+    m_clock.start();
+}
+
+GGTabBarProfiler*
+GGTabBarProfiler::instance()
+{
+    static GGTabBarProfiler profiler;
+    return &profiler;
+}
+
+const char*
+GGTabBarProfiler::operationName(Operation op)
+{
+    return (op >= 0 && op < OperationCount) ? _operationNames[op] : "";
+}
+
+void
+GGTabBarProfiler::setEnabled(bool b)
+{
+    m_bEnabled = b;
+}
+
+void
+GGTabBarProfiler::record(Operation op, qint64 startNs, qint64 durationNs)
+{
+    Stats& stats = m_aStats[op];
+    ++stats.count;
+    stats.totalNs += durationNs;
+    stats.maxNs = qMax(stats.maxNs, durationNs);
+    ++stats.histogram[_histogramBucket(durationNs)];
+
+    TraceEvent event;
+    event.op = op;
+    event.startNs = startNs;
+    event.durationNs = durationNs;
+    if( m_lTraceEvents.size() < GG_TABBAR_PROFILER_MAX_TRACE_EVENTS ) {
+        m_lTraceEvents.append(event);
+    } else {
+        m_lTraceEvents[m_iTraceHead] = event;
+        m_iTraceHead = (m_iTraceHead + 1) % m_lTraceEvents.size();
+    }
+}
+
+void
+GGTabBarProfiler::reset()
+{
+    for( int i = 0; i < OperationCount; ++i ) {
+        m_aStats[i] = Stats();
+    }
+    m_lTraceEvents.clear();
+    m_iTraceHead = 0;
+}
+
+/* Complete ("X") events, with timestamps and durations in microseconds. */
+QByteArray
+GGTabBarProfiler::chromeTrace() const
+{
+    QJsonArray events;
+    for( int i = 0; i < m_lTraceEvents.size(); ++i ) {
+        const TraceEvent& event = m_lTraceEvents.at((m_iTraceHead + i) % m_lTraceEvents.size());
+
+        QJsonObject e;
+        e["name"] = QString(operationName(event.op));
+        e["cat"] = QString("GGTabBar");
+        e["ph"] = QString("X");
+        e["ts"] = event.startNs / 1000.0;
+        e["dur"] = event.durationNs / 1000.0;
+        e["pid"] = 1;
+        e["tid"] = 1;
+        events.append(e);
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = events;
+    root["displayTimeUnit"] = QString("ms");
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+bool
+GGTabBarProfiler::writeChromeTrace(const QString& path) const
+{
+    QFile file(path);
+    if( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+        return false;
+    }
+    return file.write(this->chromeTrace()) >= 0;
+}
@@ -0,0 +1,132 @@
+#ifndef GGTABBARPROFILER_H
+#define GGTABBARPROFILER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+
+#include <cstring>
+
+/* ------------------------------------------------------------------------- */
+
+#define GG_TABBAR_PROFILER_HISTOGRAM_BUCKETS 24
+#define GG_TABBAR_PROFILER_MAX_TRACE_EVENTS 100000
+
+/*
+ * The tab bar classes are only instrumented when built with GG_TABBAR_INSTRUMENTATION defined
+ * (DEFINES += GG_TABBAR_INSTRUMENTATION in the .pro file). Otherwise the macros expand to nothing.
+ */
+#ifdef GG_TABBAR_INSTRUMENTATION
+#define GG_TABBAR_PROFILE(op)       GGTabBarProfileScope _ggTabBarProfileScope(GGTabBarProfiler::op)
+#define GG_TABBAR_PROFILE_COUNT(op) GGTabBarProfiler::instance()->count(GGTabBarProfiler::op)
+#else
+#define GG_TABBAR_PROFILE(op)
+#define GG_TABBAR_PROFILE_COUNT(op)
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+/**
+ * Records how often and how long the operations of the tab bar classes take, once enabled
+ * with setEnabled(true).
+ *
+ * For each operation, it keeps a count, the total and maximum durations, and a histogram of
+ * the durations whose bucket i counts the durations from 2^i to 2^(i+1) microseconds.
+ * The last GG_TABBAR_PROFILER_MAX_TRACE_EVENTS operations are also kept, to be exported
+ * in the Chrome trace event format (chrome://tracing, Perfetto).
+ *
+ * Layout is measured around the layouts requested by the tab bar itself, such as the one at
+ * the end of an update: QTabBar lays its tabs out privately after a single change. TabSizeHint
+ * is only counted, as timing each call would cost about as much as the call; counted operations
+ * have no duration and are not exported in the trace.
+ *
+ * It must only be used from the GUI thread.
+ */
+class GGTabBarProfiler
+{
+public:
+    enum Operation {
+        PaintEvent,
+        TabSizeHint,
+        Layout,
+        MakeVisible,
+        Scroll,
+        DisplayMenu,
+        Rename,
+        SignalForwarding,
+        MeasureTexts,
+        OperationCount
+    };
+
+    struct Stats {
+        Stats() : count(0), totalNs(0), maxNs(0) { memset(histogram, 0, sizeof(histogram)); }
+        quint64 count;
+        qint64  totalNs;
+        qint64  maxNs;
+        quint64 histogram[GG_TABBAR_PROFILER_HISTOGRAM_BUCKETS];
+    };
+
+    static GGTabBarProfiler* instance();
+    static const char* operationName(Operation op);
+
+    inline bool isEnabled() const { return m_bEnabled; }
+    void setEnabled(bool b);
+
+    inline qint64 now() const { return m_clock.nsecsElapsed(); }
+    void record(Operation op, qint64 startNs, qint64 durationNs);
+    inline void count(Operation op) { if( m_bEnabled ) { ++m_aStats[op].count; } }
+
+    inline Stats stats(Operation op) const { return m_aStats[op]; }
+    void reset();
+
+    QByteArray chromeTrace() const;
+    bool writeChromeTrace(const QString& path) const;
+
+private:
+    GGTabBarProfiler();
+
+    struct TraceEvent {
+        Operation   op;
+        qint64      startNs;
+        qint64      durationNs;
+    };
+
+private:
+    bool                m_bEnabled;
+    QElapsedTimer       m_clock;
+    Stats               m_aStats[OperationCount];
+    QVector<TraceEvent> m_lTraceEvents;                //Ring buffer starting at m_iTraceHead once full.
+    int                 m_iTraceHead;
+};
+
+/**
+ * Records the duration of the enclosing scope as an operation of GGTabBarProfiler,
+ * if the profiler is enabled when the scope is entered.
+ */
+class GGTabBarProfileScope
+{
+public:
+    explicit GGTabBarProfileScope(GGTabBarProfiler::Operation op)
+        : m_op(op)
+        , m_iStart(GGTabBarProfiler::instance()->isEnabled() ? GGTabBarProfiler::instance()->now() : -1)
+    {}
+
+    ~GGTabBarProfileScope()
+    {
+        if( m_iStart >= 0 ) {
+            GGTabBarProfiler* pProfiler = GGTabBarProfiler::instance();
+            pProfiler->record(m_op, m_iStart, pProfiler->now() - m_iStart);
+        }
+    }
+
+private:
+    GGTabBarProfileScope(const GGTabBarProfileScope&);
+    GGTabBarProfileScope& operator=(const GGTabBarProfileScope&);
+
+private:
+    GGTabBarProfiler::Operation m_op;
+    qint64                      m_iStart;
+};
+
+#endif // GGTABBARPROFILER_H
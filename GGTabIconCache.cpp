@@ -0,0 +1,111 @@
+#include "GGTabIconCache.h"
+
+#include <QCoreApplication>
+#include <QImageReader>
+#include <QMetaObject>
+#include <QPointer>
+#include <QRunnable>
+
+/* ------------------------------------------------------------------------- */
+
+static QImage
+_readImage(const QString& source, const QSize& pixelSize)
+{
+    QImageReader reader(source);
+    QSize imageSize = reader.size();
+    if( imageSize.isValid() ) {
+        reader.setScaledSize(imageSize.scaled(pixelSize, Qt::KeepAspectRatio));
+    }
+    return reader.read();
+}
+
+/* Decodes one icon in a worker thread, then hands it to the cache in the GUI thread. */
+class GGTabIconTask : public QRunnable
+{
+public:
+    GGTabIconTask(GGTabIconCache* pCache, const GGTabIconKey& key, const GGTabIconCache::Decoder& decoder)
+        : m_pCache(pCache)
+        , m_key(key)
+        , m_decoder(decoder)
+    {}
+
+    virtual void run()
+    {
+        QSize pixelSize = m_key.size * m_key.devicePixelRatio;
+        QImage image = m_decoder ? m_decoder(m_key.source, pixelSize) : _readImage(m_key.source, pixelSize);
+        QMetaObject::invokeMethod(m_pCache, "onDecoded", Qt::QueuedConnection,
+                                  Q_ARG(QString, m_key.source), Q_ARG(QSize, m_key.size),
+                                  Q_ARG(qreal, m_key.devicePixelRatio), Q_ARG(QImage, image));
+    }
+
+private:
+    GGTabIconCache*         m_pCache; //Outlives the task: its destructor waits for the pool.
+    GGTabIconKey            m_key;
+    GGTabIconCache::Decoder m_decoder;
+};
+
+/* ------------------------------------------------------------------------- */
+
+GGTabIconCache::GGTabIconCache(QObject* parent)
+    : QObject(parent)
+    , m_cache(GG_TABICONCACHE_DEFAULT_BYTE_BUDGET)
+{
+}
+
+GGTabIconCache::~GGTabIconCache()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+GGTabIconCache*
+GGTabIconCache::instance()
+{
+    static QPointer<GGTabIconCache> s_pCache;
+    if( !s_pCache ) {
+        s_pCache = new GGTabIconCache(QCoreApplication::instance());
+    }
+    return s_pCache;
+}
+
+/* Returns a null pixmap if it is not cached. */
+QPixmap
+GGTabIconCache::pixmap(const QString& source, const QSize& size, qreal devicePixelRatio) const
+{
+    QPixmap* pPixmap = m_cache.object(GGTabIconKey(source, size, devicePixelRatio));
+    return pPixmap ? *pPixmap : QPixmap();
+}
+
+void
+GGTabIconCache::request(const QString& source, const QSize& size, qreal devicePixelRatio)
+{
+    GGTabIconKey key(source, size, devicePixelRatio);
+    if( source.isEmpty() || m_cache.contains(key) || m_setPending.contains(key) ) { return; }
+
+    m_setPending.insert(key);
+    m_pool.start(new GGTabIconTask(this, key, m_decoder));
+}
+
+/* The icons being decoded are still added to the cache once decoded. */
+void
+GGTabIconCache::clear()
+{
+    m_cache.clear();
+}
+
+/*
+ * An icon that could not be decoded is not cached, nor is one larger than the budget, but the
+ * latter is still given to the tabs waiting for it.
+ */
+void
+GGTabIconCache::onDecoded(const QString& source, const QSize& size, qreal devicePixelRatio, const QImage& image)
+{
+    GGTabIconKey key(source, size, devicePixelRatio);
+    m_setPending.remove(key);
+    if( image.isNull() ) { return; }
+
+    QPixmap pixmap = QPixmap::fromImage(image);
+    pixmap.setDevicePixelRatio(devicePixelRatio);
+    m_cache.insert(key, new QPixmap(pixmap), image.bytesPerLine() * image.height());
+    emit iconReady(source, size, devicePixelRatio, pixmap);
+}
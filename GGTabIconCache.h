@@ -0,0 +1,97 @@
+#ifndef GGTABICONCACHE_H
+#define GGTABICONCACHE_H
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+
+#include <functional>
+
+/* ------------------------------------------------------------------------- */
+
+#define GG_TABICONCACHE_DEFAULT_BYTE_BUDGET (32 * 1024 * 1024)
+
+/* ------------------------------------------------------------------------- */
+
+struct GGTabIconKey
+{
+    GGTabIconKey() : devicePixelRatio(1.0) {}
+    GGTabIconKey(const QString& s, const QSize& sz, qreal dpr) : source(s), size(sz), devicePixelRatio(dpr) {}
+
+    inline bool operator==(const GGTabIconKey& o) const {
+        return source == o.source && size == o.size && devicePixelRatio == o.devicePixelRatio;
+    }
+
+    QString source;
+    QSize   size;               //In device independent pixels.
+    qreal   devicePixelRatio;
+};
+
+inline uint
+qHash(const GGTabIconKey& key, uint seed = 0)
+{
+    return qHash(key.source, seed) ^ uint(key.size.width() * 31 + key.size.height()) ^ qHash(key.devicePixelRatio, seed);
+}
+
+/**
+ * Pixmaps of the tab icons, shared by all the tab bars, decoded from their source in a thread pool.
+ *
+ * The pixmaps are keyed by source, size and device pixel ratio, so a source used by many tabs
+ * is decoded and stored once. request() decodes a pixmap that is not cached yet, unless it is
+ * already being decoded, and iconReady() is emitted with it once decoded, even if the cache could
+ * not keep it.
+ * The cache keeps at most byteBudget() bytes of pixmaps, evicting the least recently used ones;
+ * the pixmaps still shown by tabs are shared with them, not copied.
+ *
+ * Sources are file or resource paths decoded with QImageReader, unless a decoder is set:
+ * it is then called from the worker threads, with the size in device pixels.
+ *
+ * It must only be used from the GUI thread, once the QApplication is created: the instance is a
+ * child of it, so that its pixmaps are released before the application is destroyed.
+ */
+class GGTabIconCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<QImage(const QString& source, const QSize& pixelSize)> Decoder;
+
+    static GGTabIconCache* instance();
+    ~GGTabIconCache();
+
+    QPixmap pixmap(const QString& source, const QSize& size, qreal devicePixelRatio) const;
+    void request(const QString& source, const QSize& size, qreal devicePixelRatio);
+    void clear();
+
+    inline int byteBudget() const { return m_cache.maxCost(); }
+    inline void setByteBudget(int bytes) { m_cache.setMaxCost(qMax(0, bytes)); }
+    inline int cachedBytes() const { return m_cache.totalCost(); }
+    inline int cachedCount() const { return m_cache.count(); }
+    inline int pendingCount() const { return m_setPending.size(); }
+
+    inline void setDecoder(const Decoder& decoder) { m_decoder = decoder; }
+    inline QThreadPool* threadPool() { return &m_pool; }
+
+signals:
+    void iconReady(const QString& source, const QSize& size, qreal devicePixelRatio, const QPixmap& pixmap);
+
+private slots:
+    void onDecoded(const QString& source, const QSize& size, qreal devicePixelRatio, const QImage& image);
+
+private:
+    GGTabIconCache(QObject* parent);
+
+private:
+    QCache<GGTabIconKey, QPixmap>   m_cache;
+    QSet<GGTabIconKey>              m_setPending;
+    Decoder                         m_decoder;
+    QThreadPool                     m_pool;
+};
+
+#endif // GGTABICONCACHE_H
@@ -0,0 +1,606 @@
+#include "GGTabMenu.h"
+
+#include <QApplication>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+#include <QScreen>
+#else
+#include <QDesktopWidget>
+#endif
+#include <QHideEvent>
+#include <QKeyEvent>
+#include <QLineEdit>
+#include <QListView>
+#include <QListWidget>
+#include <QScrollBar>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+/* ------------------------------------------------------------------------- */
+
+bool
+GGTabMenuModel::SortKey::operator<(const SortKey& other) const
+{
+    if( order != other.order ) {
+        return order < other.order;
+    }
+    int cmp = text.compare(other.text);
+    return cmp < 0 || (0 == cmp && id < other.id);
+}
+
+GGTabMenuModel::GGTabMenuModel(QObject* parent)
+    : QAbstractListModel(parent)
+    , m_sortMode(SortByText)
+    , m_iNextRecency(0)
+{
+}
+
+GGTabMenuModel::~GGTabMenuModel()
+{
+}
+
+int
+GGTabMenuModel::rowCount(const QModelIndex& parent) const
+{
+    if( parent.isValid() ) {
+        return 0;
+    }
+    return this->isFiltered() ? m_filteredEntries.size() : m_entries.size();
+}
+
+QVariant
+GGTabMenuModel::data(const QModelIndex& index, int role) const
+{
+    if( !index.isValid() || index.row() >= this->rowCount() ) {
+        return QVariant();
+    }
+    if( Qt::DisplayRole == role ) {
+        return m_hashTexts.value(this->tabIdAt(index.row()));
+    }
+    return QVariant();
+}
+
+quint64
+GGTabMenuModel::tabIdAt(int row) const
+{
+    if( row < 0 || row >= this->rowCount() ) {
+        return 0;
+    }
+    return this->isFiltered() ? m_filteredEntries.at(row).id : m_entries.at(row).id;
+}
+
+GGTabMenuModel::SortKey
+GGTabMenuModel::sortKey(quint64 id, const QString& text) const
+{
+    SortKey key;
+    key.id = id;
+    if( SortByRecency == m_sortMode ) {
+        key.order = m_hashRecency.value(id);
+    } else {
+        key.order = 0;
+        key.text = text;
+    }
+    return key;
+}
+
+/* The order of the key is GGTabSearchIndex::NoMatch if the tab does not match the filter. */
+GGTabMenuModel::SortKey
+GGTabMenuModel::filterKey(quint64 id, const QString& text) const
+{
+    SortKey key;
+    key.id = id;
+    key.text = GGTabSearchIndex::foldCase(text);
+    key.order = GGTabSearchIndex::match(m_sFoldedFilter, key.text);
+    return key;
+}
+
+int
+GGTabMenuModel::rowOf(quint64 id) const
+{
+    QHash<quint64, QString>::const_iterator it = m_hashTexts.constFind(id);
+    if( it == m_hashTexts.constEnd() ) {
+        return -1;
+    }
+    if( this->isFiltered() ) {
+        return m_filteredEntries.rank(this->filterKey(id, it.value()));
+    }
+    return m_entries.rank(this->sortKey(id, it.value()));
+}
+
+void
+GGTabMenuModel::insertTab(quint64 id, const QString& text)
+{
+    if( m_hashTexts.contains(id) ) {
+        this->renameTab(id, text);
+        return;
+    }
+
+    m_hashTexts.insert(id, text);
+    m_searchIndex.insert(id, text);
+    if( SortByRecency == m_sortMode ) {
+        m_hashRecency.insert(id, m_iNextRecency++);
+    }
+
+    SortKey key = this->sortKey(id, text);
+    if( this->isFiltered() ) {
+        m_entries.insert(key);
+        this->insertFiltered(id, text);
+        return;
+    }
+
+    int row = m_entries.lowerBound(key);
+    this->beginInsertRows(QModelIndex(), row, row);
+    m_entries.insert(key);
+    this->endInsertRows();
+}
+
+void
+GGTabMenuModel::removeTab(quint64 id)
+{
+    QHash<quint64, QString>::const_iterator it = m_hashTexts.constFind(id);
+    if( it == m_hashTexts.constEnd() ) { return; }
+
+    QString text = it.value();
+    SortKey key = this->sortKey(id, text);
+    bool bFiltered = this->isFiltered();
+    if( !bFiltered ) {
+        int row = m_entries.rank(key);
+        this->beginRemoveRows(QModelIndex(), row, row);
+    }
+    m_entries.remove(key);
+    m_hashTexts.remove(id);
+    m_hashRecency.remove(id);
+    m_searchIndex.remove(id);
+    if( !bFiltered ) {
+        this->endRemoveRows();
+    } else {
+        this->removeFiltered(id, text);
+    }
+}
+
+void
+GGTabMenuModel::renameTab(quint64 id, const QString& text)
+{
+    QHash<quint64, QString>::const_iterator it = m_hashTexts.constFind(id);
+    if( it == m_hashTexts.constEnd() ) {
+        this->insertTab(id, text);
+        return;
+    }
+
+    QString oldText = it.value();
+    SortKey oldKey = this->sortKey(id, oldText);
+    SortKey newKey = this->sortKey(id, text);
+    m_hashTexts.insert(id, text);
+    m_searchIndex.rename(id, text);
+
+    if( this->isFiltered() ) {
+        m_entries.remove(oldKey);
+        m_entries.insert(newKey);
+        this->removeFiltered(id, oldText);
+        this->insertFiltered(id, text);
+        return;
+    }
+
+    //Row of the renamed entry once removed from its current row.
+    int from = m_entries.rank(oldKey);
+    int to = m_entries.lowerBound(newKey);
+    if( oldKey < newKey ) {
+        --to;
+    }
+
+    if( to == from ) {
+        m_entries.remove(oldKey);
+        m_entries.insert(newKey);
+        QModelIndex index = this->index(from);
+        emit dataChanged(index, index);
+    } else {
+        this->beginMoveRows(QModelIndex(), from, from, QModelIndex(), to > from ? to + 1 : to);
+        m_entries.remove(oldKey);
+        m_entries.insert(newKey);
+        this->endMoveRows();
+    }
+}
+
+/* Inserts the row of the tab if it matches the filter and ranks among the results kept. */
+void
+GGTabMenuModel::insertFiltered(quint64 id, const QString& text)
+{
+    SortKey key = this->filterKey(id, text);
+    if( GGTabSearchIndex::NoMatch == key.order || m_filteredEntries.contains(key) ) { return; }
+
+    int row = m_filteredEntries.lowerBound(key);
+    if( row >= GG_TABSEARCH_DEFAULT_MAX_RESULTS ) { return; }
+
+    this->beginInsertRows(QModelIndex(), row, row);
+    m_filteredEntries.insert(key);
+    this->endInsertRows();
+
+    if( m_filteredEntries.size() > GG_TABSEARCH_DEFAULT_MAX_RESULTS ) {
+        int last = m_filteredEntries.size() - 1;
+        SortKey lastKey = m_filteredEntries.at(last);
+        this->beginRemoveRows(QModelIndex(), last, last);
+        m_filteredEntries.remove(lastKey);
+        this->endRemoveRows();
+    }
+}
+
+/*
+ * Removes the row of the tab, given with the text it was listed with. If the results were capped,
+ * the next one takes its place: the search index must no longer have that text.
+ */
+void
+GGTabMenuModel::removeFiltered(quint64 id, const QString& text)
+{
+    SortKey key = this->filterKey(id, text);
+    int row = m_filteredEntries.rank(key);
+    if( row < 0 ) { return; }
+
+    bool bCapped = GG_TABSEARCH_DEFAULT_MAX_RESULTS == m_filteredEntries.size();
+    this->beginRemoveRows(QModelIndex(), row, row);
+    m_filteredEntries.remove(key);
+    this->endRemoveRows();
+
+    if( bCapped ) {
+        QVector<quint64> lIds = m_searchIndex.search(m_sFilter);
+        if( GG_TABSEARCH_DEFAULT_MAX_RESULTS == lIds.size() ) {
+            this->insertFiltered(lIds.last(), m_hashTexts.value(lIds.last()));
+        }
+    }
+}
+
+void
+GGTabMenuModel::setFilter(const QString& filter)
+{
+    if( filter == m_sFilter ) { return; }
+
+    m_sFilter = filter;
+    this->refilter();
+}
+
+/* Going back to SortByText sorts the tabs, which are then kept sorted. */
+void
+GGTabMenuModel::setSortMode(SortMode mode)
+{
+    if( mode == m_sortMode ) { return; }
+
+    this->beginResetModel();
+    const QVector<SortKey> lOldKeys = m_entries.toVector();
+    m_sortMode = mode;
+    if( SortByRecency == mode ) {
+        QVector<quint64> lIds;
+        lIds.reserve(lOldKeys.size());
+        for( const SortKey& key : lOldKeys ) {
+            lIds.append(key.id);
+        }
+        this->setRecencyOrder(lIds);
+    } else {
+        m_hashRecency.clear();
+        QVector<SortKey> lKeys;
+        lKeys.reserve(lOldKeys.size());
+        for( const SortKey& key : lOldKeys ) {
+            lKeys.append(this->sortKey(key.id, m_hashTexts.value(key.id)));
+        }
+        std::sort(lKeys.begin(), lKeys.end());
+        m_entries.assignSorted(lKeys);
+    }
+    this->endResetModel();
+}
+
+/* ids must be the ids of all the tabs of the model. */
+void
+GGTabMenuModel::setRecentTabs(const QVector<quint64>& ids)
+{
+    if( SortByRecency != m_sortMode ) { return; }
+
+    Q_ASSERT(ids.size() == m_hashTexts.size());
+    if( this->isFiltered() ) {
+        this->setRecencyOrder(ids); //The filtered rows do not depend on it.
+        return;
+    }
+    this->beginResetModel();
+    this->setRecencyOrder(ids);
+    this->endResetModel();
+}
+
+/* Stamps the tabs from the most recent one: new tabs get the next stamps. */
+void
+GGTabMenuModel::setRecencyOrder(const QVector<quint64>& ids)
+{
+    m_hashRecency.clear();
+    m_hashRecency.reserve(ids.size());
+    QVector<SortKey> lKeys;
+    lKeys.reserve(ids.size());
+    for( int i = 0; i < ids.size(); ++i ) {
+        m_hashRecency.insert(ids.at(i), i);
+        lKeys.append(this->sortKey(ids.at(i), QString()));
+    }
+    m_iNextRecency = ids.size();
+    m_entries.assignSorted(lKeys);
+}
+
+/* The search results are already ranked by match kind, folded text and id. */
+void
+GGTabMenuModel::rebuildFiltered()
+{
+    m_sFoldedFilter = GGTabSearchIndex::foldCase(m_sFilter);
+
+    QVector<SortKey> lKeys;
+    if( this->isFiltered() ) {
+        const QVector<quint64> lIds = m_searchIndex.search(m_sFilter);
+        lKeys.reserve(lIds.size());
+        for( quint64 id : lIds ) {
+            lKeys.append(this->filterKey(id, m_hashTexts.value(id)));
+        }
+    }
+    m_filteredEntries.assignSorted(lKeys);
+}
+
+void
+GGTabMenuModel::refilter()
+{
+    this->beginResetModel();
+    this->rebuildFiltered();
+    this->endResetModel();
+}
+
+/*
+ * Rebuilds the whole model at once, e.g. after a batch of mutations.
+ * In the SortByRecency mode, ids are listed from the most recent tab.
+ */
+void
+GGTabMenuModel::resetTabs(const QVector<quint64>& ids, const QStringList& texts)
+{
+    Q_ASSERT(ids.size() == texts.size());
+
+    this->beginResetModel();
+    m_hashTexts.clear();
+    m_hashTexts.reserve(ids.size());
+    m_searchIndex.clear();
+    for( int i = 0; i < ids.size(); ++i ) {
+        m_hashTexts.insert(ids.at(i), texts.at(i));
+        m_searchIndex.insert(ids.at(i), texts.at(i));
+    }
+    if( SortByRecency == m_sortMode ) {
+        this->setRecencyOrder(ids); //Already in the expected order.
+    } else {
+        QVector<SortKey> lKeys;
+        lKeys.reserve(ids.size());
+        for( int i = 0; i < ids.size(); ++i ) {
+            lKeys.append(this->sortKey(ids.at(i), texts.at(i)));
+        }
+        std::sort(lKeys.begin(), lKeys.end());
+        m_entries.assignSorted(lKeys);
+    }
+    this->rebuildFiltered();
+    this->endResetModel();
+}
+
+/* ------------------------------------------------------------------------- */
+/* ------------------------------------------------------------------------- */
+
+GGTabMenuPopup::GGTabMenuPopup(GGTabMenuModel* pModel, QWidget* parent)
+    : QFrame(parent, Qt::Popup)
+    , m_pModel(pModel)
+    , m_pFilterEdit(nullptr)
+    , m_pListView(nullptr)
+    , m_iMaxVisibleRows(GG_TABMENU_MAX_VISIBLE_ROWS)
+{
+    QVBoxLayout* pLayout = new QVBoxLayout(this);
+    pLayout->setMargin(0);
+    pLayout->setSpacing(0);
+
+    m_pFilterEdit = new QLineEdit(this);
+    m_pFilterEdit->setClearButtonEnabled(true);
+    m_pFilterEdit->installEventFilter(this);
+    pLayout->addWidget(m_pFilterEdit);
+
+    m_pListView = new QListView(this);
+    m_pListView->setModel(m_pModel);
+    m_pListView->setUniformItemSizes(true); //Rows are never measured one by one.
+    m_pListView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_pListView->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_pListView->setTextElideMode(Qt::ElideRight);
+    m_pListView->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    m_pListView->setFrameShape(QFrame::NoFrame);
+    m_pListView->setFocusProxy(m_pFilterEdit);
+    pLayout->addWidget(m_pListView);
+
+    this->setFrameShape(QFrame::StyledPanel);
+
+    connect(m_pFilterEdit, &QLineEdit::textChanged,         this, &GGTabMenuPopup::onFilterChanged);
+    connect(m_pListView,   &QAbstractItemView::clicked,     this, &GGTabMenuPopup::onIndexActivated);
+    connect(m_pListView,   &QAbstractItemView::activated,   this, &GGTabMenuPopup::onIndexActivated);
+}
+
+GGTabMenuPopup::~GGTabMenuPopup()
+{
+}
+
+/* Shows the popup right under pAnchor, with the row of currentTabId selected. */
+void
+GGTabMenuPopup::popup(QWidget* pAnchor, quint64 currentTabId)
+{
+    int rows = qMin(m_pModel->rowCount(), m_iMaxVisibleRows);
+    if( 0 == rows ) { return; }
+
+    int rowHeight = m_pListView->sizeHintForRow(0);
+    int frame = 2 * this->frameWidth();
+    QSize size(qMax(GG_TABMENU_DEFAULT_WIDTH, pAnchor->width()), m_pFilterEdit->sizeHint().height() + rows * rowHeight + frame);
+    if( rows < m_pModel->rowCount() ) {
+        size.rwidth() += m_pListView->verticalScrollBar()->sizeHint().width();
+    }
+
+    QPoint pos = pAnchor->mapToGlobal(QPoint(pAnchor->width() - size.width(), pAnchor->height()));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    QScreen* pScreen = QGuiApplication::screenAt(pAnchor->mapToGlobal(pAnchor->rect().center()));
+    QRect screen = (pScreen ? pScreen : QGuiApplication::primaryScreen())->availableGeometry();
+#else
+    QRect screen = QApplication::desktop()->availableGeometry(pAnchor);
+#endif
+    pos.setX(qBound(screen.left(), pos.x(), screen.right() - size.width()));
+    if( pos.y() + size.height() > screen.bottom() ) {
+        pos.setY(pAnchor->mapToGlobal(QPoint(0, 0)).y() - size.height());
+    }
+
+    this->setGeometry(QRect(pos, size));
+
+    int row = m_pModel->rowOf(currentTabId);
+    if( row >= 0 ) {
+        m_pListView->setCurrentIndex(m_pModel->index(row));
+        m_pListView->scrollTo(m_pModel->index(row), QAbstractItemView::PositionAtCenter);
+    } else {
+        m_pListView->scrollToTop();
+    }
+
+    this->show();
+    m_pFilterEdit->setFocus();
+}
+
+void
+GGTabMenuPopup::onIndexActivated(const QModelIndex& index)
+{
+    if( !this->isVisible() ) { return; } //clicked() and activated() may both be emitted.
+
+    quint64 id = m_pModel->tabIdAt(index.row()); //Hiding clears the filter.
+    this->hide();
+    emit tabActivated(id);
+}
+
+void
+GGTabMenuPopup::onFilterChanged(const QString& text)
+{
+    m_pModel->setFilter(text);
+    if( m_pModel->rowCount() > 0 ) {
+        m_pListView->setCurrentIndex(m_pModel->index(0));
+    }
+}
+
+void
+GGTabMenuPopup::hideEvent(QHideEvent* e)
+{
+    m_pFilterEdit->clear();
+    QFrame::hideEvent(e);
+}
+
+/* The search field keeps the focus: navigation keys are forwarded to the list. */
+bool
+GGTabMenuPopup::eventFilter(QObject* o, QEvent* e)
+{
+    if( o == m_pFilterEdit && QEvent::KeyPress == e->type() ) {
+        QKeyEvent* pKeyEvent = static_cast<QKeyEvent*>(e);
+        switch( pKeyEvent->key() ) {
+        case Qt::Key_Up:
+        case Qt::Key_Down:
+        case Qt::Key_PageUp:
+        case Qt::Key_PageDown:
+            QApplication::sendEvent(m_pListView, e);
+            return true;
+        case Qt::Key_Return:
+        case Qt::Key_Enter:
+            if( m_pListView->currentIndex().isValid() ) {
+                this->onIndexActivated(m_pListView->currentIndex());
+            }
+            return true;
+        default:
+            break;
+        }
+    }
+
+    return QFrame::eventFilter(o, e);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ------------------------------------------------------------------------- */
+
+GGTabSwitcherPopup::GGTabSwitcherPopup(QWidget* parent)
+    : QFrame(parent, Qt::Popup)
+    , m_pListWidget(nullptr)
+{
+    QVBoxLayout* pLayout = new QVBoxLayout(this);
+    pLayout->setMargin(0);
+
+    m_pListWidget = new QListWidget(this);
+    m_pListWidget->setUniformItemSizes(true);
+    m_pListWidget->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_pListWidget->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_pListWidget->setTextElideMode(Qt::ElideRight);
+    m_pListWidget->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    m_pListWidget->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    m_pListWidget->setFrameShape(QFrame::NoFrame);
+    m_pListWidget->installEventFilter(this);
+    pLayout->addWidget(m_pListWidget);
+
+    this->setFrameShape(QFrame::StyledPanel);
+
+    connect(m_pListWidget, &QListWidget::itemClicked, this, &GGTabSwitcherPopup::activateCurrent);
+}
+
+GGTabSwitcherPopup::~GGTabSwitcherPopup()
+{
+}
+
+/* Shows the tabs centered on the window of pAnchor, with the given row selected. */
+void
+GGTabSwitcherPopup::popup(QWidget* pAnchor, const QVector<quint64>& ids, const QStringList& texts, const QList<QIcon>& icons, int row)
+{
+    if( ids.isEmpty() ) { return; }
+
+    m_lIds = ids;
+    m_pListWidget->clear();
+    for( int i = 0; i < ids.size(); ++i ) {
+        m_pListWidget->addItem(new QListWidgetItem(icons.value(i), texts.value(i)));
+    }
+    m_pListWidget->setCurrentRow(qBound(0, row, ids.size() - 1));
+
+    int frame = 2 * this->frameWidth();
+    QSize size(GG_TABMENU_DEFAULT_WIDTH + frame, ids.size() * m_pListWidget->sizeHintForRow(0) + frame);
+    QRect window = pAnchor->window()->geometry();
+    QPoint pos = window.center() - QPoint(size.width() / 2, size.height() / 2);
+    this->setGeometry(QRect(pos, size));
+
+    this->show();
+    m_pListWidget->setFocus();
+}
+
+/* Tab and Backtab cycle through the tabs; releasing Ctrl activates the selected one. */
+bool
+GGTabSwitcherPopup::eventFilter(QObject* o, QEvent* e)
+{
+    if( o == m_pListWidget && QEvent::KeyPress == e->type() ) {
+        QKeyEvent* pKeyEvent = static_cast<QKeyEvent*>(e);
+        int count = m_pListWidget->count();
+        switch( pKeyEvent->key() ) {
+        case Qt::Key_Tab:
+            m_pListWidget->setCurrentRow((m_pListWidget->currentRow() + 1) % count);
+            return true;
+        case Qt::Key_Backtab:
+            m_pListWidget->setCurrentRow((m_pListWidget->currentRow() + count - 1) % count);
+            return true;
+        case Qt::Key_Return:
+        case Qt::Key_Enter:
+            this->activateCurrent();
+            return true;
+        default:
+            break;
+        }
+    } else if( o == m_pListWidget && QEvent::KeyRelease == e->type() ) {
+        if( Qt::Key_Control == static_cast<QKeyEvent*>(e)->key() ) {
+            this->activateCurrent();
+            return true;
+        }
+    }
+
+    return QFrame::eventFilter(o, e);
+}
+
+void
+GGTabSwitcherPopup::activateCurrent()
+{
+    if( !this->isVisible() ) { return; }
+
+    int row = m_pListWidget->currentRow();
+    this->hide();
+    if( row >= 0 && row < m_lIds.size() ) {
+        emit tabActivated(m_lIds.at(row));
+    }
+}
@@ -0,0 +1,171 @@
+#ifndef GGTABMENU_H
+#define GGTABMENU_H
+
+#include <QAbstractListModel>
+#include <QFrame>
+#include <QHash>
+#include <QIcon>
+#include <QList>
+#include <QStringList>
+#include <QVector>
+
+#include "GGRankedSet.h"
+#include "GGTabSearchIndex.h"
+
+class QLineEdit;
+class QListView;
+class QListWidget;
+
+/* ------------------------------------------------------------------------- */
+
+#define GG_TABMENU_MAX_VISIBLE_ROWS 20
+#define GG_TABMENU_DEFAULT_WIDTH 250
+
+/* ------------------------------------------------------------------------- */
+
+/**
+ * List model of the tabs of a tab bar, sorted by alphabetical order.
+ *
+ * Tabs are identified by their stable id (see GGTabBar::tabId()), so moving a tab does not
+ * change the model. The rows are kept in a GGRankedSet, so inserting, removing or renaming a tab
+ * is O(log n). In the SortByRecency mode, the tabs are listed in the order last given to
+ * setRecentTabs() instead, new tabs being appended to it.
+ *
+ * When a filter is set, the model only lists the tabs matching it, ranked as by its
+ * GGTabSearchIndex, and inserts and removes their rows as the tabs change.
+ */
+class GGTabMenuModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum SortMode {
+        SortByText,
+        SortByRecency
+    };
+
+    GGTabMenuModel(QObject* parent = nullptr);
+    ~GGTabMenuModel();
+
+    virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    virtual QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+
+    quint64 tabIdAt(int row) const;
+    int rowOf(quint64 id) const;
+
+    void insertTab(quint64 id, const QString& text);
+    void removeTab(quint64 id);
+    void renameTab(quint64 id, const QString& text);
+    void resetTabs(const QVector<quint64>& ids, const QStringList& texts);
+
+    inline QString filter() const { return m_sFilter; }
+    void setFilter(const QString& filter);
+
+    inline SortMode sortMode() const { return m_sortMode; }
+    void setSortMode(SortMode mode);
+    void setRecentTabs(const QVector<quint64>& ids); //From the most recent, in the SortByRecency mode.
+
+private:
+    struct SortKey
+    {
+        qint64  order;  //0 by text, the recency stamp by recency, the match kind when filtered.
+        QString text;   //Empty by recency, case folded when filtered.
+        quint64 id;
+
+        bool operator<(const SortKey& other) const;
+    };
+
+    SortKey sortKey(quint64 id, const QString& text) const;
+    SortKey filterKey(quint64 id, const QString& text) const;
+    inline bool isFiltered() const { return !m_sFilter.isEmpty(); }
+    void setRecencyOrder(const QVector<quint64>& ids);
+    void rebuildFiltered();
+    void refilter();
+    void insertFiltered(quint64 id, const QString& text);
+    void removeFiltered(quint64 id, const QString& text);
+
+private:
+    SortMode                m_sortMode;
+    GGRankedSet<SortKey>    m_entries;
+    QHash<quint64, QString> m_hashTexts;
+    QHash<quint64, qint64>  m_hashRecency;  //Only in the SortByRecency mode.
+    qint64                  m_iNextRecency;
+
+    GGTabSearchIndex        m_searchIndex;
+    QString                 m_sFilter;
+    QString                 m_sFoldedFilter;
+    GGRankedSet<SortKey>    m_filteredEntries; //At most GG_TABSEARCH_DEFAULT_MAX_RESULTS.
+};
+
+/**
+ * Popup listing the tabs of a GGTabMenuModel.
+ * Only the rows that are scrolled into view are laid out and painted.
+ *
+ * Typing in the search field at its top filters the tabs; the arrow keys move through
+ * the matches and Enter activates the selected one. The filter is cleared when the popup is
+ * hidden, so that the model does not search the tabs again on each change while it is closed.
+ */
+class GGTabMenuPopup : public QFrame
+{
+    Q_OBJECT
+
+public:
+    GGTabMenuPopup(GGTabMenuModel* pModel, QWidget* parent = nullptr);
+    ~GGTabMenuPopup();
+
+    inline int maxVisibleRows() const { return m_iMaxVisibleRows; }
+    inline void setMaxVisibleRows(int rows) { m_iMaxVisibleRows = qMax(1, rows); }
+
+    void popup(QWidget* pAnchor, quint64 currentTabId);
+
+signals:
+    void tabActivated(quint64 id);
+
+protected:
+    virtual bool eventFilter(QObject* o, QEvent* e);
+    virtual void hideEvent(QHideEvent* e);
+
+protected slots:
+    void onIndexActivated(const QModelIndex& index);
+    void onFilterChanged(const QString& text);
+
+private:
+    GGTabMenuModel* m_pModel;
+    QLineEdit*      m_pFilterEdit;
+    QListView*      m_pListView;
+    int             m_iMaxVisibleRows;
+};
+
+/**
+ * Ctrl+Tab popup listing a few tabs, the most recently current ones in GGTabBarWidget.
+ *
+ * Tab and Shift+Tab move the selection, with wrap-around, and releasing Ctrl or pressing
+ * Enter activates the selected tab. Escape or a click outside closes it.
+ */
+class GGTabSwitcherPopup : public QFrame
+{
+    Q_OBJECT
+
+public:
+    GGTabSwitcherPopup(QWidget* parent = nullptr);
+    ~GGTabSwitcherPopup();
+
+    void popup(QWidget* pAnchor, const QVector<quint64>& ids, const QStringList& texts, const QList<QIcon>& icons, int row);
+
+signals:
+    void tabActivated(quint64 id);
+
+protected:
+    virtual bool eventFilter(QObject* o, QEvent* e);
+
+protected slots:
+    void activateCurrent();
+
+private:
+    QListWidget*        m_pListWidget;
+    QVector<quint64>    m_lIds;
+};
+
+/* ------------------------------------------------------------------------- */
+
+#endif /* GGTABMENU_H */
@@ -0,0 +1,270 @@
+#include "GGTabSearchIndex.h"
+
+#include <algorithm>
+
+/* ------------------------------------------------------------------------- */
+
+GGTabSearchIndex::GGTabSearchIndex()
+{
+}
+
+GGTabSearchIndex::~GGTabSearchIndex()
+{
+}
+
+QString
+GGTabSearchIndex::foldCase(const QString& text)
+{
+    return text.toCaseFolded();
+}
+
+/* One bit per character class: a key can only contain the query if it has all the query bits. */
+quint64
+GGTabSearchIndex::signature(const QString& key)
+{
+    quint64 sig = 0;
+    for( int i = 0; i < key.size(); ++i ) {
+        sig |= Q_UINT64_C(1) << (key.at(i).unicode() % 64);
+    }
+    return sig;
+}
+
+quint64
+GGTabSearchIndex::trigram(const QString& key, int pos)
+{
+    return (quint64(key.at(pos).unicode()) << 32)
+         | (quint64(key.at(pos + 1).unicode()) << 16)
+         |  quint64(key.at(pos + 2).unicode());
+}
+
+/* Distinct trigrams of key, sorted. */
+QVector<quint64>
+GGTabSearchIndex::trigrams(const QString& key)
+{
+    QVector<quint64> lTrigrams;
+    if( key.size() < 3 ) {
+        return lTrigrams;
+    }
+
+    lTrigrams.reserve(key.size() - 2);
+    for( int i = 0; i + 2 < key.size(); ++i ) {
+        lTrigrams.append(trigram(key, i));
+    }
+    std::sort(lTrigrams.begin(), lTrigrams.end());
+    lTrigrams.erase(std::unique(lTrigrams.begin(), lTrigrams.end()), lTrigrams.end());
+    return lTrigrams;
+}
+
+bool
+GGTabSearchIndex::isSubsequence(const QString& query, const QString& key)
+{
+    int q = 0;
+    for( int k = 0; k < key.size() && q < query.size(); ++k ) {
+        if( key.at(k) == query.at(q) ) {
+            ++q;
+        }
+    }
+    return q == query.size();
+}
+
+GGTabSearchIndex::MatchKind
+GGTabSearchIndex::match(const QString& foldedQuery, const QString& foldedText)
+{
+    if( foldedQuery.isEmpty() ) { return NoMatch; }
+
+    int pos = foldedText.indexOf(foldedQuery);
+    if( 0 == pos ) { return PrefixMatch; }
+    if( pos > 0 ) { return SubstringMatch; }
+    return isSubsequence(foldedQuery, foldedText) ? FuzzyMatch : NoMatch;
+}
+
+void
+GGTabSearchIndex::insert(quint64 id, const QString& text)
+{
+    if( m_hashSlots.contains(id) ) {
+        this->rename(id, text);
+        return;
+    }
+
+    QString key = foldCase(text);
+
+    int slot;
+    if( !m_lFreeSlots.isEmpty() ) {
+        slot = m_lFreeSlots.takeLast();
+        m_lSlotIds[slot] = id;
+        m_lSlotSignatures[slot] = signature(key);
+        m_lSlotKeys[slot] = key;
+    } else {
+        slot = m_lSlotIds.size();
+        m_lSlotIds.append(id);
+        m_lSlotSignatures.append(signature(key));
+        m_lSlotKeys.append(key);
+    }
+    m_hashSlots.insert(id, slot);
+
+    //Ids are mostly increasing, so this is usually an append.
+    const QVector<quint64> lTrigrams = trigrams(key);
+    for( int i = 0; i < lTrigrams.size(); ++i ) {
+        QVector<quint64>& lPosting = m_hashPostings[lTrigrams.at(i)];
+        if( lPosting.isEmpty() || lPosting.last() < id ) {
+            lPosting.append(id);
+        } else {
+            lPosting.insert(std::lower_bound(lPosting.begin(), lPosting.end(), id), id);
+        }
+    }
+}
+
+void
+GGTabSearchIndex::remove(quint64 id)
+{
+    QHash<quint64, int>::iterator it = m_hashSlots.find(id);
+    if( it == m_hashSlots.end() ) { return; }
+
+    int slot = it.value();
+    m_hashSlots.erase(it);
+
+    const QVector<quint64> lTrigrams = trigrams(m_lSlotKeys.at(slot));
+    for( int i = 0; i < lTrigrams.size(); ++i ) {
+        QHash<quint64, QVector<quint64> >::iterator itPosting = m_hashPostings.find(lTrigrams.at(i));
+        if( itPosting == m_hashPostings.end() ) { continue; }
+
+        QVector<quint64>& lPosting = itPosting.value();
+        QVector<quint64>::iterator itId = std::lower_bound(lPosting.begin(), lPosting.end(), id);
+        if( itId != lPosting.end() && *itId == id ) {
+            lPosting.erase(itId);
+        }
+        if( lPosting.isEmpty() ) {
+            m_hashPostings.erase(itPosting);
+        }
+    }
+
+    m_lSlotIds[slot] = 0;
+    m_lSlotSignatures[slot] = 0;
+    m_lSlotKeys[slot] = QString();
+    m_lFreeSlots.append(slot);
+}
+
+void
+GGTabSearchIndex::rename(quint64 id, const QString& text)
+{
+    this->remove(id);
+    this->insert(id, text);
+}
+
+void
+GGTabSearchIndex::clear()
+{
+    m_lSlotIds.clear();
+    m_lSlotSignatures.clear();
+    m_lSlotKeys.clear();
+    m_lFreeSlots.clear();
+    m_hashSlots.clear();
+    m_hashPostings.clear();
+}
+
+/* Ids of the tabs having every trigram of query, smallest posting list first. */
+QVector<quint64>
+GGTabSearchIndex::candidatesFor(const QString& query) const
+{
+    const QVector<quint64> lTrigrams = trigrams(query);
+    QVector<const QVector<quint64>*> lPostings;
+    lPostings.reserve(lTrigrams.size());
+
+    for( int i = 0; i < lTrigrams.size(); ++i ) {
+        QHash<quint64, QVector<quint64> >::const_iterator it = m_hashPostings.constFind(lTrigrams.at(i));
+        if( it == m_hashPostings.constEnd() ) {
+            return QVector<quint64>();
+        }
+        lPostings.append(&it.value());
+    }
+    std::sort(lPostings.begin(), lPostings.end(), [](const QVector<quint64>* p1, const QVector<quint64>* p2) {
+        return p1->size() < p2->size();
+    });
+
+    QVector<quint64> lCandidates = *lPostings.first();
+    for( int i = 1; i < lPostings.size() && !lCandidates.isEmpty(); ++i ) {
+        const QVector<quint64>& lPosting = *lPostings.at(i);
+        QVector<quint64> lKept;
+        lKept.reserve(lCandidates.size());
+        for( int c = 0; c < lCandidates.size(); ++c ) {
+            if( std::binary_search(lPosting.begin(), lPosting.end(), lCandidates.at(c)) ) {
+                lKept.append(lCandidates.at(c));
+            }
+        }
+        lCandidates.swap(lKept);
+    }
+    return lCandidates;
+}
+
+QVector<quint64>
+GGTabSearchIndex::search(const QString& query, int maxResults) const
+{
+    QString q = foldCase(query);
+    if( q.isEmpty() || maxResults <= 0 ) {
+        return QVector<quint64>();
+    }
+
+    QVector<int> lPrefix;
+    QVector<int> lSubstring;
+    QVector<int> lFuzzy;
+
+    //Every match is collected before being ranked, so that the best ones are kept whatever their slot.
+    if( q.size() >= 3 ) {
+        const QVector<quint64> lCandidates = this->candidatesFor(q);
+        for( int i = 0; i < lCandidates.size(); ++i ) {
+            int slot = m_hashSlots.value(lCandidates.at(i));
+            int pos = m_lSlotKeys.at(slot).indexOf(q);
+            if( 0 == pos ) {
+                lPrefix.append(slot);
+            } else if( pos > 0 ) {
+                lSubstring.append(slot);
+            }
+        }
+    }
+
+    //Fuzzy matches, and substrings too short for the trigrams, come from the signatures.
+    if( q.size() < 3 || lPrefix.size() + lSubstring.size() < maxResults ) {
+        const quint64 sig = signature(q);
+        const bool bShort = q.size() < 3;
+        const quint64* pSignatures = m_lSlotSignatures.constData();
+
+        for( int slot = 0; slot < m_lSlotSignatures.size(); ++slot ) {
+            if( (pSignatures[slot] & sig) != sig || 0 == m_lSlotIds.at(slot) ) {
+                continue;
+            }
+
+            const QString& key = m_lSlotKeys.at(slot);
+            int pos = bShort ? key.indexOf(q) : -1;
+            if( 0 == pos ) {
+                lPrefix.append(slot);
+            } else if( pos > 0 ) {
+                lSubstring.append(slot);
+            } else if( (bShort || !key.contains(q)) && isSubsequence(q, key) ) {
+                lFuzzy.append(slot);
+            }
+        }
+    }
+
+    QVector<quint64> lResults;
+    lResults.reserve(qMin(maxResults, lPrefix.size() + lSubstring.size() + lFuzzy.size()));
+
+    //Only the matches kept are sorted.
+    const QVector<QString>& lKeys = m_lSlotKeys;
+    const QVector<quint64>& lIds = m_lSlotIds;
+    auto byKey = [&lKeys, &lIds](int s1, int s2) {
+        int cmp = lKeys.at(s1).compare(lKeys.at(s2));
+        return cmp < 0 || (0 == cmp && lIds.at(s1) < lIds.at(s2));
+    };
+    QVector<int>* lGroups[] = { &lPrefix, &lSubstring, &lFuzzy };
+    for( int g = 0; g < 3 && lResults.size() < maxResults; ++g ) {
+        QVector<int>& lGroup = *lGroups[g];
+        int count = qMin(lGroup.size(), maxResults - lResults.size());
+        std::partial_sort(lGroup.begin(), lGroup.begin() + count, lGroup.end(), byKey);
+        for( int i = 0; i < count; ++i ) {
+            lResults.append(m_lSlotIds.at(lGroup.at(i)));
+        }
+    }
+    return lResults;
+}
+
+/* ------------------------------------------------------------------------- */
@@ -0,0 +1,71 @@
+#ifndef GGTABSEARCHINDEX_H
+#define GGTABSEARCHINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+/* ------------------------------------------------------------------------- */
+
+#define GG_TABSEARCH_DEFAULT_MAX_RESULTS 500
+
+/* ------------------------------------------------------------------------- */
+
+/**
+ * Case-insensitive search index over tab labels, keyed by tab id.
+ *
+ * Queries of 3 characters or more are answered by intersecting trigram posting lists.
+ * Shorter queries and fuzzy (subsequence) matching use a contiguous array of per-tab
+ * character signatures, so that most labels are rejected without being read.
+ *
+ * Results are ordered by match kind (prefix, then substring, then fuzzy), then alphabetically,
+ * and are capped to maxResults once ranked: a short query matching most of the tabs still
+ * returns the first ones in that order, not the first ones found.
+ */
+class GGTabSearchIndex
+{
+public:
+    enum MatchKind {
+        PrefixMatch,
+        SubstringMatch,
+        FuzzyMatch,
+        NoMatch
+    };
+
+    GGTabSearchIndex();
+    ~GGTabSearchIndex();
+
+    void insert(quint64 id, const QString& text);
+    void remove(quint64 id);
+    void rename(quint64 id, const QString& text);
+    void clear();
+    inline int size() const { return m_hashSlots.size(); }
+
+    QVector<quint64> search(const QString& query, int maxResults = GG_TABSEARCH_DEFAULT_MAX_RESULTS) const;
+
+    //Ranks a single label as search() does: by match kind, then by folded text, then by id.
+    static MatchKind match(const QString& foldedQuery, const QString& foldedText);
+    static QString foldCase(const QString& text);
+
+private:
+    static quint64 signature(const QString& key);
+    static quint64 trigram(const QString& key, int pos);
+    static QVector<quint64> trigrams(const QString& key);
+    static bool isSubsequence(const QString& query, const QString& key);
+
+    QVector<quint64> candidatesFor(const QString& query) const;
+
+private:
+    //One slot per tab; the slots of the removed tabs are reused.
+    QVector<quint64>            m_lSlotIds;
+    QVector<quint64>            m_lSlotSignatures;
+    QVector<QString>            m_lSlotKeys;
+    QVector<int>                m_lFreeSlots;
+    QHash<quint64, int>         m_hashSlots;
+
+    QHash<quint64, QVector<quint64> > m_hashPostings; //Trigram -> sorted tab ids.
+};
+
+/* ------------------------------------------------------------------------- */
+
+#endif /* GGTABSEARCHINDEX_H */
@@ -0,0 +1,453 @@
+#include "GGTabSession.h"
+#include "GGTabBar.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QHash>
+#include <QPair>
+#include <QtEndian>
+
+#include <climits>
+
+/* ------------------------------------------------------------------------- */
+
+struct GGTabSessionLoader::Record {
+    quint32 textOffset;
+    quint32 textSize;
+    quint32 iconKeyOffset;
+    quint32 iconKeySize;
+    quint32 toolTipOffset;
+    quint32 toolTipSize;
+    quint32 dataOffset;
+    quint32 dataSize;
+    QRgb    textColor;
+    quint32 flags;
+};
+
+static inline void
+_write32(QByteArray& bytes, int position, quint32 value)
+{
+    qToLittleEndian<quint32>(value, reinterpret_cast<uchar*>(bytes.data()) + position);
+}
+
+static inline quint32
+_read32(const uchar* p, int position)
+{
+    return qFromLittleEndian<quint32>(p + position);
+}
+
+/* Writes the (offset, size) of s in strings at position, appending s the first time it is seen. */
+static void
+_writeString(QByteArray& bytes, int position, const QString& s, QByteArray& strings, QHash<QString, QPair<quint32, quint32> >& hashStrings)
+{
+    if( s.isEmpty() ) { return; }
+
+    QHash<QString, QPair<quint32, quint32> >::const_iterator it = hashStrings.constFind(s);
+    if( it == hashStrings.constEnd() ) {
+        QByteArray utf8 = s.toUtf8();
+        it = hashStrings.insert(s, qMakePair(quint32(strings.size()), quint32(utf8.size())));
+        strings.append(utf8);
+    }
+    _write32(bytes, position, it.value().first);
+    _write32(bytes, position + 4, it.value().second);
+}
+
+/* ------------------------------------------------------------------------- */
+
+QByteArray
+GGTabSession::save(const GGTabBarWidget* pWidget, const IconKeyFunction& iconKey)
+{
+    int count = pWidget->count();
+    QByteArray session(GG_TABSESSION_HEADER_SIZE + count * GG_TABSESSION_RECORD_SIZE, '\0');
+    QByteArray strings;
+    QByteArray data;
+    QHash<QString, QPair<quint32, quint32> > hashStrings;
+
+    for( int i = 0; i < count; ++i ) {
+        int record = GG_TABSESSION_HEADER_SIZE + i * GG_TABSESSION_RECORD_SIZE;
+        quint32 flags = 0;
+
+        _writeString(session, record, pWidget->tabText(i), strings, hashStrings);
+
+        QString iconSource = pWidget->tabIconSource(i);
+        QIcon icon = pWidget->tabIcon(i);
+        if( !iconSource.isEmpty() ) {
+            _writeString(session, record + 8, iconSource, strings, hashStrings);
+            flags |= GGTabSession::HasIconSource;
+        } else if( !icon.isNull() ) {
+            _writeString(session, record + 8, iconKey ? iconKey(icon) : icon.name(), strings, hashStrings);
+        }
+
+#ifndef QT_NO_TOOLTIP
+        _writeString(session, record + 16, pWidget->tabToolTip(i), strings, hashStrings);
+#endif
+
+        QVariant tabData = pWidget->tabData(i);
+        if( tabData.isValid() ) {
+            QByteArray bytes;
+            QDataStream stream(&bytes, QIODevice::WriteOnly);
+            stream.setVersion(QDataStream::Qt_5_0);
+            stream << tabData;
+            _write32(session, record + 24, quint32(data.size()));
+            _write32(session, record + 28, quint32(bytes.size()));
+            data.append(bytes);
+        }
+
+        QColor color = pWidget->tabTextColor(i);
+        if( color.isValid() ) {
+            _write32(session, record + 32, color.rgba());
+            flags |= GGTabSession::HasTextColor;
+        }
+        if( !pWidget->isTabEnabled(i) ) {
+            flags |= GGTabSession::Disabled;
+        }
+        _write32(session, record + 36, flags);
+    }
+
+    int stringsOffset = session.size();
+    int dataOffset = stringsOffset + strings.size();
+    _write32(session, 0, GG_TABSESSION_MAGIC);
+    qToLittleEndian<quint16>(GG_TABSESSION_VERSION, reinterpret_cast<uchar*>(session.data()) + 4);
+    qToLittleEndian<quint16>(GG_TABSESSION_RECORD_SIZE, reinterpret_cast<uchar*>(session.data()) + 6);
+    _write32(session, 8, quint32(count));
+    _write32(session, 12, quint32(pWidget->currentIndex()));
+    _write32(session, 16, quint32(pWidget->scrollOffset()));
+    _write32(session, 20, GG_TABSESSION_HEADER_SIZE);
+    _write32(session, 24, quint32(stringsOffset));
+    _write32(session, 28, quint32(strings.size()));
+    _write32(session, 32, quint32(dataOffset));
+    _write32(session, 36, quint32(data.size()));
+
+    session.append(strings);
+    session.append(data);
+    return session;
+}
+
+bool
+GGTabSession::saveToFile(const GGTabBarWidget* pWidget, const QString& path, const IconKeyFunction& iconKey)
+{
+    QFile file(path);
+    if( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+        return false;
+    }
+    QByteArray session = GGTabSession::save(pWidget, iconKey);
+    return file.write(session) == session.size();
+}
+
+bool
+GGTabSession::restore(GGTabBarWidget* pWidget, const QByteArray& session, const IconLoader& iconLoader)
+{
+    GGTabSessionLoader loader(pWidget);
+    loader.setIconLoader(iconLoader);
+    return loader.load(session);
+}
+
+bool
+GGTabSession::restoreFromFile(GGTabBarWidget* pWidget, const QString& path, const IconLoader& iconLoader)
+{
+    GGTabSessionLoader loader(pWidget);
+    loader.setIconLoader(iconLoader);
+    return loader.loadFile(path);
+}
+
+/* ------------------------------------------------------------------------- */
+
+GGTabSessionLoader::GGTabSessionLoader(GGTabBarWidget* pWidget, QObject* parent)
+    : QObject(parent)
+    , m_pWidget(pWidget)
+    , m_iChunkSize(GG_TABSESSION_DEFAULT_CHUNK_SIZE)
+    , m_pFile(nullptr)
+    , m_pMapped(nullptr)
+    , m_pData(nullptr)
+    , m_iSize(0)
+    , m_iRecordSize(0)
+    , m_iCount(0)
+    , m_iCurrent(-1)
+    , m_iScrollOffset(0)
+    , m_iRecordsOffset(0)
+    , m_iStringsOffset(0)
+    , m_iStringsSize(0)
+    , m_iDataOffset(0)
+    , m_iDataSize(0)
+    , m_iLoaded(0)
+    , m_iFirstLoaded(0)
+    , m_iLastLoaded(0)
+    , m_iFirstId(0)
+    , m_iLastId(0)
+    , m_bRecordsSkipped(false)
+{
+    connect(&m_timer, &QTimer::timeout, this, &GGTabSessionLoader::loadNextChunk);
+    connect(pWidget, &QObject::destroyed, this, &GGTabSessionLoader::cancel);
+}
+
+GGTabSessionLoader::~GGTabSessionLoader()
+{
+    this->cancel();
+}
+
+bool
+GGTabSessionLoader::load(const QByteArray& session, bool bIncremental)
+{
+    this->cancel();
+    m_session = session;
+    m_pData = reinterpret_cast<const uchar*>(m_session.constData());
+    m_iSize = m_session.size();
+    return this->start(bIncremental);
+}
+
+/* Falls back to reading the file if it cannot be mapped. */
+bool
+GGTabSessionLoader::loadFile(const QString& path, bool bIncremental)
+{
+    this->cancel();
+    m_pFile = new QFile(path);
+    if( !m_pFile->open(QIODevice::ReadOnly) ) {
+        this->release();
+        return false;
+    }
+
+    m_iSize = m_pFile->size();
+    m_pMapped = m_pFile->map(0, m_iSize);
+    if( m_pMapped ) {
+        m_pData = m_pMapped;
+    } else {
+        m_session = m_pFile->readAll();
+        m_pData = reinterpret_cast<const uchar*>(m_session.constData());
+        m_iSize = m_session.size();
+    }
+    return this->start(bIncremental);
+}
+
+void
+GGTabSessionLoader::cancel()
+{
+    m_timer.stop();
+    this->release();
+}
+
+/* Checks that the header and the blocks it points to fit in the session, then loads the first chunk. */
+bool
+GGTabSessionLoader::start(bool bIncremental)
+{
+    m_iLoaded = 0;
+    m_iCount = 0;
+    m_bRecordsSkipped = false;
+
+    if( !m_pWidget || m_iSize < GG_TABSESSION_HEADER_SIZE || m_pWidget->model()
+        || _read32(m_pData, 0) != GG_TABSESSION_MAGIC ) {
+        this->release();
+        return false;
+    }
+
+    quint16 version = qFromLittleEndian<quint16>(m_pData + 4);
+    m_iRecordSize = qFromLittleEndian<quint16>(m_pData + 6);
+    quint32 count = _read32(m_pData, 8);
+    m_iCurrent = int(_read32(m_pData, 12));
+    m_iScrollOffset = int(_read32(m_pData, 16));
+    m_iRecordsOffset = _read32(m_pData, 20);
+    m_iStringsOffset = _read32(m_pData, 24);
+    m_iStringsSize = _read32(m_pData, 28);
+    m_iDataOffset = _read32(m_pData, 32);
+    m_iDataSize = _read32(m_pData, 36);
+
+    quint64 size = quint64(m_iSize);
+    if( version < 1 || version > GG_TABSESSION_VERSION || m_iRecordSize < GG_TABSESSION_RECORD_SIZE
+        || count > quint32(INT_MAX) || m_iCurrent < -1 || m_iCurrent >= qint64(count)
+        || quint64(m_iRecordsOffset) + quint64(count) * quint64(m_iRecordSize) > size
+        || quint64(m_iStringsOffset) + m_iStringsSize > size
+        || quint64(m_iDataOffset) + m_iDataSize > size ) {
+        this->release();
+        return false;
+    }
+    m_iCount = int(count);
+
+    int first = 0;
+    int last = m_iCount;
+    if( bIncremental && m_iCount > m_iChunkSize ) {
+        first = qBound(0, m_iCurrent - m_iChunkSize / 2, m_iCount - m_iChunkSize);
+        last = first + m_iChunkSize;
+    }
+
+    m_pWidget->beginUpdate();
+    m_pWidget->removeTabs(0, m_pWidget->count());
+    int current = this->insertRecords(first, last, 0);
+    if( current >= 0 ) {
+        m_pWidget->setCurrentIndex(current);
+    }
+    m_pWidget->endUpdate();
+
+    m_iFirstLoaded = first;
+    m_iLastLoaded = last;
+    int loaded = m_pWidget->count();
+    m_iFirstId = loaded > 0 ? m_pWidget->tabId(0) : 0;
+    m_iLastId = loaded > 0 ? m_pWidget->tabId(loaded - 1) : 0;
+
+    emit progress(m_iLoaded, m_iCount);
+    if( 0 == first && m_iCount == last ) {
+        this->finish();
+    } else {
+        m_timer.start(0);
+    }
+    return true;
+}
+
+/*
+ * Loads the next chunk after the loaded tabs, then the one before them, each inserted next to
+ * the loaded tabs at the end of the bar, wherever they have been moved since.
+ */
+void
+GGTabSessionLoader::loadNextChunk()
+{
+    if( !m_pData || !m_pWidget ) { return; }
+
+    m_pWidget->beginUpdate();
+    if( m_iLastLoaded < m_iCount ) {
+        int last = qMin(m_iCount, m_iLastLoaded + m_iChunkSize);
+        int index = m_pWidget->tabIndex(m_iLastId);
+        index = index < 0 ? m_pWidget->count() : index + 1;
+
+        int count = m_pWidget->count();
+        this->insertRecords(m_iLastLoaded, last, index);
+        if( m_pWidget->count() > count ) {
+            m_iLastId = m_pWidget->tabId(index + m_pWidget->count() - count - 1);
+        }
+        m_iLastLoaded = last;
+    }
+    if( m_iFirstLoaded > 0 ) {
+        int first = qMax(0, m_iFirstLoaded - m_iChunkSize);
+        int index = qMax(0, m_pWidget->tabIndex(m_iFirstId));
+
+        int count = m_pWidget->count();
+        this->insertRecords(first, m_iFirstLoaded, index);
+        if( m_pWidget->count() > count ) {
+            m_iFirstId = m_pWidget->tabId(index);
+        }
+        m_iFirstLoaded = first;
+    }
+    m_pWidget->endUpdate();
+
+    emit progress(m_iLoaded, m_iCount);
+    if( 0 == m_iFirstLoaded && m_iCount == m_iLastLoaded ) {
+        this->finish();
+    }
+}
+
+/* Returns false if the strings or the data of the record are outside of their block. */
+bool
+GGTabSessionLoader::readRecord(int i, Record& record) const
+{
+    const uchar* p = m_pData + m_iRecordsOffset + qint64(i) * m_iRecordSize;
+    record.textOffset = _read32(p, 0);
+    record.textSize = _read32(p, 4);
+    record.iconKeyOffset = _read32(p, 8);
+    record.iconKeySize = _read32(p, 12);
+    record.toolTipOffset = _read32(p, 16);
+    record.toolTipSize = _read32(p, 20);
+    record.dataOffset = _read32(p, 24);
+    record.dataSize = _read32(p, 28);
+    record.textColor = _read32(p, 32);
+    record.flags = _read32(p, 36);
+
+    return quint64(record.textOffset) + record.textSize <= m_iStringsSize
+        && quint64(record.iconKeyOffset) + record.iconKeySize <= m_iStringsSize
+        && quint64(record.toolTipOffset) + record.toolTipSize <= m_iStringsSize
+        && quint64(record.dataOffset) + record.dataSize <= m_iDataSize;
+}
+
+QString
+GGTabSessionLoader::readString(quint32 offset, quint32 size) const
+{
+    return QString::fromUtf8(reinterpret_cast<const char*>(m_pData + m_iStringsOffset + offset), int(size));
+}
+
+/*
+ * Inserts the tabs of the valid records from first to last at once, then sets their other attributes.
+ * Returns the index of the tab of the current record, -1 if it is not among them.
+ */
+int
+GGTabSessionLoader::insertRecords(int first, int last, int index)
+{
+    QVector<Record> records;
+    QStringList texts;
+    int current = -1;
+    records.reserve(last - first);
+    texts.reserve(last - first);
+    for( int i = first; i < last; ++i ) {
+        Record record;
+        if( !this->readRecord(i, record) ) {
+            m_bRecordsSkipped = true;
+            continue;
+        }
+        if( i == m_iCurrent ) {
+            current = index + records.size();
+        }
+        records.append(record);
+        texts.append(this->readString(record.textOffset, record.textSize));
+    }
+    if( records.isEmpty() ) { return -1; }
+
+    int tab = m_pWidget->insertTabs(index, texts);
+    for( int i = 0; i < records.size(); ++i, ++tab ) {
+        const Record& record = records.at(i);
+
+        if( record.iconKeySize > 0 && (record.flags & GGTabSession::HasIconSource) ) {
+            m_pWidget->setTabIconSource(tab, this->readString(record.iconKeyOffset, record.iconKeySize));
+        } else if( record.iconKeySize > 0 ) {
+            QString key = this->readString(record.iconKeyOffset, record.iconKeySize);
+            QIcon icon = m_iconLoader ? m_iconLoader(key) : QIcon::fromTheme(key);
+            if( !icon.isNull() ) {
+                m_pWidget->setTabIcon(tab, icon);
+            }
+        }
+        if( record.flags & GGTabSession::HasTextColor ) {
+            m_pWidget->setTabTextColor(tab, QColor::fromRgba(record.textColor));
+        }
+#ifndef QT_NO_TOOLTIP
+        if( record.toolTipSize > 0 ) {
+            m_pWidget->setTabToolTip(tab, this->readString(record.toolTipOffset, record.toolTipSize));
+        }
+#endif
+        if( record.dataSize > 0 ) {
+            QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char*>(m_pData + m_iDataOffset + record.dataOffset), int(record.dataSize));
+            QDataStream stream(bytes);
+            stream.setVersion(QDataStream::Qt_5_0);
+            QVariant data;
+            stream >> data;
+            if( QDataStream::Ok == stream.status() ) {
+                m_pWidget->setTabData(tab, data);
+            }
+        }
+        if( record.flags & GGTabSession::Disabled ) {
+            m_pWidget->setTabEnabled(tab, false);
+        }
+    }
+    m_iLoaded += records.size();
+    return current;
+}
+
+void
+GGTabSessionLoader::finish()
+{
+    m_timer.stop();
+    //Without the skipped tabs, the offset would no longer show the same tabs: the current one is shown instead.
+    if( m_pWidget && !m_bRecordsSkipped ) {
+        m_pWidget->setScrollOffset(m_iScrollOffset);
+    }
+    this->release();
+    emit finished();
+}
+
+void
+GGTabSessionLoader::release()
+{
+    m_pData = nullptr;
+    m_session.clear();
+    if( m_pFile ) {
+        if( m_pMapped ) {
+            m_pFile->unmap(m_pMapped);
+        }
+        delete m_pFile;
+    }
+    m_pFile = nullptr;
+    m_pMapped = nullptr;
+}
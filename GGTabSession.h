@@ -0,0 +1,153 @@
+#ifndef GGTABSESSION_H
+#define GGTABSESSION_H
+
+#include <QByteArray>
+#include <QIcon>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QTimer>
+
+#include <functional>
+
+class QFile;
+class GGTabBarWidget;
+
+/* ------------------------------------------------------------------------- */
+
+#define GG_TABSESSION_MAGIC 0x53544747 //"GGTS"
+#define GG_TABSESSION_VERSION 1
+#define GG_TABSESSION_HEADER_SIZE 40
+#define GG_TABSESSION_RECORD_SIZE 40
+#define GG_TABSESSION_DEFAULT_CHUNK_SIZE 256
+
+/* ------------------------------------------------------------------------- */
+
+/**
+ * Saves the tabs of a GGTabBarWidget to a compact binary session: their order, text, icon key,
+ * data, text color, tool tip and enabled state, the current index and the scroll offset.
+ *
+ * All the integers are little endian. The session starts with a header:
+ *   magic, version (16 bits), record size (16 bits), tab count, current index, scroll offset,
+ *   records offset, strings offset, strings size, data offset, data size
+ * followed by one fixed size record per tab:
+ *   text, icon key, tool tip and data as (offset, size) pairs, text color (QRgb), RecordFlags
+ * then by the strings, in UTF-8 and shared by the tabs with the same ones, and by the data,
+ * as QVariants written by QDataStream.
+ * The offsets of the strings and of the data are relative to their block, so a session can be
+ * read in place, from a memory-mapped file (see GGTabSessionLoader).
+ *
+ * The version is only increased by incompatible changes: fields may be added at the end of the
+ * header and of the records, since readers locate the records and their fields from the header.
+ *
+ * Icons are saved by key: the tabIconSource() of the tab if it has one, otherwise the key
+ * returned by the IconKeyFunction, the theme name of the icon (QIcon::name()) by default.
+ * The icons without key are not saved.
+ */
+class GGTabSession
+{
+public:
+    enum RecordFlag {
+        HasTextColor    = 0x1,
+        Disabled        = 0x2,
+        HasIconSource   = 0x4   //The icon key is a GGTabBar::tabIconSource().
+    };
+
+    typedef std::function<QString(const QIcon& icon)> IconKeyFunction;
+    typedef std::function<QIcon(const QString& key)> IconLoader;
+
+    static QByteArray save(const GGTabBarWidget* pWidget, const IconKeyFunction& iconKey = IconKeyFunction());
+    static bool saveToFile(const GGTabBarWidget* pWidget, const QString& path, const IconKeyFunction& iconKey = IconKeyFunction());
+
+    //Replaces the tabs of pWidget at once. Returns false if the session is invalid.
+    static bool restore(GGTabBarWidget* pWidget, const QByteArray& session, const IconLoader& iconLoader = IconLoader());
+    static bool restoreFromFile(GGTabBarWidget* pWidget, const QString& path, const IconLoader& iconLoader = IconLoader());
+};
+
+/**
+ * Restores a session saved by GGTabSession into a GGTabBarWidget, replacing its tabs.
+ * Sessions cannot be restored into a GGTabBarWidget showing a model.
+ *
+ * The tabs are inserted by chunks of chunkSize() tabs in beginUpdate()/endUpdate() batches,
+ * so that the tabs are laid out once per chunk rather than once per tab.
+ * The first chunk is the one around the current tab. In a full restore, it is extended to all
+ * the tabs. In an incremental restore, the other tabs are loaded afterwards, one chunk on each
+ * side per event loop iteration, so that the visible tabs can be used right away. progress() is
+ * emitted after each chunk and finished() once all the tabs are loaded, when the scroll offset
+ * is restored. Invalid records are skipped, and the scroll offset is then left to the current tab.
+ * Loading stops if the GGTabBarWidget is destroyed.
+ *
+ * Files are memory-mapped until the restore is finished, so that they are neither read
+ * nor copied as a whole.
+ *
+ * Icon sources are given back to setTabIconSource(), so they are decoded asynchronously.
+ * The other icons are loaded from their key by the IconLoader, QIcon::fromTheme() by default.
+ */
+class GGTabSessionLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    GGTabSessionLoader(GGTabBarWidget* pWidget, QObject* parent = nullptr);
+    ~GGTabSessionLoader();
+
+    inline void setIconLoader(const GGTabSession::IconLoader& loader) { m_iconLoader = loader; }
+    inline int chunkSize() const { return m_iChunkSize; }
+    inline void setChunkSize(int tabs) { m_iChunkSize = qMax(1, tabs); }
+
+    bool load(const QByteArray& session, bool bIncremental = false);
+    bool loadFile(const QString& path, bool bIncremental = false);
+    void cancel(); //Keeps the tabs already loaded.
+
+    inline bool isLoading() const { return nullptr != m_pData; }
+    inline int loadedCount() const { return m_iLoaded; }
+    inline int totalCount() const { return m_iCount; }
+
+signals:
+    void progress(int loaded, int total);
+    void finished();
+
+private slots:
+    void loadNextChunk();
+
+private:
+    struct Record;
+
+    bool start(bool bIncremental);
+    bool readRecord(int i, Record& record) const;
+    QString readString(quint32 offset, quint32 size) const;
+    int insertRecords(int first, int last, int index);
+    void finish();
+    void release();
+
+private:
+    QPointer<GGTabBarWidget>    m_pWidget;  //Loading is canceled if it is destroyed.
+    GGTabSession::IconLoader    m_iconLoader;
+    int                         m_iChunkSize;
+    QTimer                      m_timer;
+
+    QByteArray                  m_session;
+    QFile*                      m_pFile;
+    uchar*                      m_pMapped;
+    const uchar*                m_pData;    //nullptr when not loading.
+    qint64                      m_iSize;
+
+    int                         m_iRecordSize;
+    int                         m_iCount;
+    int                         m_iCurrent;
+    int                         m_iScrollOffset;
+    quint32                     m_iRecordsOffset;
+    quint32                     m_iStringsOffset;
+    quint32                     m_iStringsSize;
+    quint32                     m_iDataOffset;
+    quint32                     m_iDataSize;
+
+    int                         m_iLoaded;
+    int                         m_iFirstLoaded;     //Records [m_iFirstLoaded, m_iLastLoaded) are loaded,
+    int                         m_iLastLoaded;
+    quint64                     m_iFirstId;         //in the tabs from m_iFirstId to m_iLastId.
+    quint64                     m_iLastId;
+    bool                        m_bRecordsSkipped;  //Invalid records are not loaded.
+};
+
+#endif // GGTABSESSION_H
@@ -0,0 +1,167 @@
+#include "GGTabUpdateQueue.h"
+
+/* ------------------------------------------------------------------------- */
+
+void
+GGTabUpdate::merge(const GGTabUpdate& other)
+{
+    if( other.fields & TextField ) {
+        text = other.text;
+    }
+    if( other.fields & TextColorField ) {
+        textColor = other.textColor;
+    }
+    if( other.fields & IconField ) {
+        icon = other.icon;
+    }
+    fields |= other.fields;
+}
+
+/* ------------------------------------------------------------------------- */
+
+GGTabUpdateQueue::GGTabUpdateQueue(QObject* parent)
+    : QObject(parent)
+    , m_pHead(&m_stub)
+    , m_pTail(&m_stub)
+    , m_iScheduled(0)
+    , m_iFrameInterval(GG_TABUPDATEQUEUE_DEFAULT_FRAME_INTERVAL)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &GGTabUpdateQueue::onTimeout);
+}
+
+GGTabUpdateQueue::~GGTabUpdateQueue()
+{
+    while( Node* pNode = this->pop() ) {
+        delete pNode;
+    }
+}
+
+void
+GGTabUpdateQueue::postTabText(quint64 id, const QString& text)
+{
+    GGTabUpdate update;
+    update.id = id;
+    update.fields = GGTabUpdate::TextField;
+    update.text = text;
+    this->post(update);
+}
+
+void
+GGTabUpdateQueue::postTabTextColor(quint64 id, const QColor& color)
+{
+    GGTabUpdate update;
+    update.id = id;
+    update.fields = GGTabUpdate::TextColorField;
+    update.textColor = color;
+    this->post(update);
+}
+
+void
+GGTabUpdateQueue::postTabIcon(quint64 id, const QImage& icon)
+{
+    GGTabUpdate update;
+    update.id = id;
+    update.fields = GGTabUpdate::IconField;
+    update.icon = icon;
+    this->post(update);
+}
+
+/* Only the first update posted since the last updatesReady() wakes the GUI thread up. */
+void
+GGTabUpdateQueue::post(const GGTabUpdate& update)
+{
+    Node* pNode = new Node;
+    pNode->update = update;
+    this->push(pNode);
+
+    if( m_iScheduled.testAndSetOrdered(0, 1) ) {
+        QMetaObject::invokeMethod(this, "scheduleUpdates", Qt::QueuedConnection);
+    }
+}
+
+QHash<quint64, GGTabUpdate>
+GGTabUpdateQueue::takeAll()
+{
+    QHash<quint64, GGTabUpdate> updates;
+    while( Node* pNode = this->pop() ) {
+        QHash<quint64, GGTabUpdate>::iterator it = updates.find(pNode->update.id);
+        if( it == updates.end() ) {
+            updates.insert(pNode->update.id, pNode->update);
+        } else {
+            it.value().merge(pNode->update);
+        }
+        delete pNode;
+    }
+    return updates;
+}
+
+/* Waits for the rest of the frame if the last updates were applied less than a frame ago. */
+void
+GGTabUpdateQueue::scheduleUpdates()
+{
+    if( m_timer.isActive() ) { return; }
+
+    qint64 elapsed = m_lastUpdate.isValid() ? m_lastUpdate.elapsed() : m_iFrameInterval;
+    m_timer.start(int(qMax<qint64>(0, m_iFrameInterval - elapsed)));
+}
+
+/* Updates posted from now on schedule the next frame, even if they are taken by this one. */
+void
+GGTabUpdateQueue::onTimeout()
+{
+    m_lastUpdate.start();
+    m_iScheduled.fetchAndStoreOrdered(0);
+    emit updatesReady();
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Intrusive MPSC list (D. Vyukov): producers exchange the head, then link the previous head
+ * to their node. The consumer follows the links from the tail; the stub node keeps the list
+ * from ever being empty, so that producers never touch the tail.
+ */
+void
+GGTabUpdateQueue::push(Node* pNode)
+{
+    pNode->next.store(nullptr);
+    Node* pPrevious = m_pHead.fetchAndStoreOrdered(pNode);
+    pPrevious->next.storeRelease(pNode);
+}
+
+/*
+ * Returns nullptr when the queue is empty, or when a producer has exchanged the head but not
+ * linked its node yet: that producer then schedules another frame, which will take the node.
+ */
+GGTabUpdateQueue::Node*
+GGTabUpdateQueue::pop()
+{
+    Node* pTail = m_pTail;
+    Node* pNext = pTail->next.loadAcquire();
+
+    if( pTail == &m_stub ) {
+        if( !pNext ) { return nullptr; }
+        m_pTail = pNext;
+        pTail = pNext;
+        pNext = pNext->next.loadAcquire();
+    }
+
+    if( pNext ) {
+        m_pTail = pNext;
+        return pTail;
+    }
+
+    if( pTail != m_pHead.loadAcquire() ) {
+        return nullptr;
+    }
+
+    //pTail is the last node: put the stub back behind it before taking it.
+    this->push(&m_stub);
+    pNext = pTail->next.loadAcquire();
+    if( pNext ) {
+        m_pTail = pNext;
+        return pTail;
+    }
+    return nullptr;
+}
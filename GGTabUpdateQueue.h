@@ -0,0 +1,100 @@
+#ifndef GGTABUPDATEQUEUE_H
+#define GGTABUPDATEQUEUE_H
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QColor>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+/* ------------------------------------------------------------------------- */
+
+#define GG_TABUPDATEQUEUE_DEFAULT_FRAME_INTERVAL 16
+
+/* ------------------------------------------------------------------------- */
+
+/**
+ * Changes to apply to the tab with the given id.
+ * Only the members flagged in fields are meaningful.
+ */
+struct GGTabUpdate
+{
+    enum Field {
+        TextField       = 0x1,
+        TextColorField  = 0x2,
+        IconField       = 0x4
+    };
+
+    GGTabUpdate() : id(0), fields(0) {}
+
+    void merge(const GGTabUpdate& other);
+
+    quint64 id;
+    int     fields;
+    QString text;
+    QColor  textColor;
+    QImage  icon; //QPixmap cannot be created outside of the GUI thread.
+};
+
+/**
+ * Multiple-producer, single-consumer queue of tab updates.
+ *
+ * The post methods may be called from any thread without locking: each update is pushed
+ * on an intrusive lock-free list. The queue itself lives in the GUI thread, where it emits
+ * updatesReady() at most once per frameInterval(), however many updates were posted.
+ * takeAll() then returns the pending updates, merged per tab id, the latest value of each
+ * field winning.
+ *
+ * The producers must stop posting before the queue is destroyed.
+ */
+class GGTabUpdateQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    GGTabUpdateQueue(QObject* parent = nullptr);
+    ~GGTabUpdateQueue();
+
+    //Thread-safe.
+    void postTabText(quint64 id, const QString& text);
+    void postTabTextColor(quint64 id, const QColor& color);
+    void postTabIcon(quint64 id, const QImage& icon);
+    void post(const GGTabUpdate& update);
+
+    //GUI thread only.
+    QHash<quint64, GGTabUpdate> takeAll();
+    inline int frameInterval() const { return m_iFrameInterval; }
+    inline void setFrameInterval(int ms) { m_iFrameInterval = qMax(0, ms); }
+
+signals:
+    void updatesReady();
+
+private slots:
+    void scheduleUpdates();
+    void onTimeout();
+
+private:
+    struct Node {
+        QAtomicPointer<Node> next;
+        GGTabUpdate update;
+    };
+
+    void push(Node* pNode);
+    Node* pop();
+
+private:
+    QAtomicPointer<Node>    m_pHead;    //Last pushed node, exchanged by the producers.
+    Node*                   m_pTail;    //Next node to pop, only read by the consumer.
+    Node                    m_stub;
+    QAtomicInt              m_iScheduled;
+
+    QTimer                  m_timer;
+    QElapsedTimer           m_lastUpdate;
+    int                     m_iFrameInterval;
+};
+
+#endif // GGTABUPDATEQUEUE_H
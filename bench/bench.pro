@@ -0,0 +1,11 @@
+TEMPLATE = app
+TARGET   = GGTabBarBench
+
+include(../GGTabBar.pri)
+
+SOURCES += \
+        benchmark.cpp \
+        main.cpp
+
+HEADERS += \
+        benchmark.h
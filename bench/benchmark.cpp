@@ -0,0 +1,839 @@
+#include "benchmark.h"
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QTimer>
+
+#include <ctime>
+#include <random>
+
+#include "GGTabBar.h"
+#include "GGTabBarProfiler.h"
+#include "GGTabMenu.h"
+#include "GGTabSession.h"
+
+namespace {
+
+const int _benchmarkTabCounts[] = { 10, 100, 1000, 10000, 100000 };
+
+QString
+_argValue(const QStringList& args, const QString& name, const QString& defaultValue)
+{
+    int i = args.indexOf(name);
+    return (i >= 0 && i + 1 < args.size()) ? args.at(i + 1) : defaultValue;
+}
+
+QStringList
+_tabTexts(int count, int first = 0)
+{
+    QStringList texts;
+    texts.reserve(count);
+    for( int i = 0; i < count; ++i ) {
+        texts << QString("Tab %1").arg(first + i);
+    }
+    return texts;
+}
+
+/* Resident set size of the process in bytes, -1 when the platform does not expose it. */
+qint64
+_residentBytes()
+{
+    QFile file("/proc/self/status");
+    if( !file.open(QIODevice::ReadOnly | QIODevice::Text) ) {
+        return -1;
+    }
+    for( QByteArray line = file.readLine(); !line.isEmpty(); line = file.readLine() ) {
+        if( line.startsWith("VmRSS:") ) {
+            return line.mid(6).trimmed().split(' ').first().toLongLong() * 1024;
+        }
+    }
+    return -1;
+}
+
+bool
+_writeJson(const QJsonObject& root, const QString& path)
+{
+    QFile file(path);
+    bool bOpened = path.isEmpty() ? file.open(stdout, QIODevice::WriteOnly)
+                                  : file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    if( !bOpened ) {
+        qWarning("Cannot write the results to %s", qPrintable(path));
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson());
+    return true;
+}
+
+void
+_hidePopup()
+{
+    if( QWidget* pPopup = QApplication::activePopupWidget() ) {
+        pPopup->hide();
+    }
+}
+
+class BenchmarkResults
+{
+public:
+    void add(int tabs, const QString& name, int ops, qint64 nsecs)
+    {
+        QJsonObject result;
+        result["tabs"] = tabs;
+        result["case"] = name;
+        result["ops"] = ops;
+        result["nsTotal"] = double(nsecs);
+        result["nsPerOp"] = ops > 0 ? double(nsecs) / ops : 0.0;
+        m_results.append(result);
+    }
+
+    void addMemory(int tabs, qint64 bytes, const QString& name = QString("memory"))
+    {
+        QJsonObject result;
+        result["tabs"] = tabs;
+        result["case"] = name;
+        result["bytesPerTab"] = bytes < 0 ? -1.0 : double(bytes) / tabs;
+        m_results.append(result);
+    }
+
+    void addCpu(int tabs, const QString& name, int ops, qint64 nsecs, double cpuSeconds)
+    {
+        QJsonObject result;
+        result["tabs"] = tabs;
+        result["case"] = name;
+        result["ops"] = ops;
+        result["nsTotal"] = double(nsecs);
+        result["cpuPercent"] = nsecs > 0 ? 100.0 * cpuSeconds * 1e9 / nsecs : 0.0;
+        m_results.append(result);
+    }
+
+    inline QJsonArray results() const { return m_results; }
+
+private:
+    QJsonArray m_results;
+};
+
+/* Every tab of a 1,000 tabs bar gets a new progress and badge 30 times per second. */
+void
+_benchmarkIndicators(BenchmarkResults& results, bool bVirtualized, int seconds)
+{
+    const int tabs = 1000;
+
+    GGTabBarWidget w;
+    w.resize(800, 40);
+    w.setVirtualized(bVirtualized);
+    w.addTabs(_tabTexts(tabs));
+    w.show();
+    QApplication::processEvents();
+
+    GGTabIndicatorDriver driver(w.findChild<GGTabBar*>());
+    QTimer ticks;
+    ticks.setInterval(1000 / 30);
+    QObject::connect(&ticks, &QTimer::timeout, &driver, &GGTabIndicatorDriver::tick);
+
+    QEventLoop loop;
+    QElapsedTimer timer;
+    std::clock_t cpuStart = std::clock();
+    timer.start();
+    ticks.start();
+    QTimer::singleShot(seconds * 1000, &loop, &QEventLoop::quit);
+    loop.exec();
+    ticks.stop();
+
+    double cpuSeconds = double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    results.addCpu(tabs, "indicators30Hz", driver.updates(), timer.nsecsElapsed(), cpuSeconds);
+}
+
+/*
+ * Closable tabs inserted one by one each lay all the tabs out, as QTabBar does when it sets the
+ * close button of a tab. In a batch, they are laid out once and only get their close button once
+ * in view.
+ */
+void
+_benchmarkBatchInsert(BenchmarkResults& results, int maxTabs)
+{
+    const int aTabCounts[] = { 1000, 10000, 100000 };
+    for( int tabs : aTabCounts ) {
+        if( tabs > maxTabs ) { break; }
+
+        QStringList texts = _tabTexts(tabs);
+        QElapsedTimer timer;
+        if( tabs <= 1000 ) {
+            GGTabBarWidget w;
+            w.resize(800, 40);
+            w.setTabsClosable(true);
+            w.show();
+            QApplication::processEvents();
+            timer.start();
+            for( int i = 0; i < tabs; ++i ) {
+                w.addTab(texts.at(i));
+            }
+            QApplication::processEvents();
+            results.add(tabs, "addTabClosableUnbatched", tabs, timer.nsecsElapsed());
+        }
+        {
+            GGTabBarWidget w;
+            w.resize(800, 40);
+            w.setTabsClosable(true);
+            w.show();
+            QApplication::processEvents();
+            timer.start();
+            w.addTabs(texts);
+            QApplication::processEvents();
+            results.add(tabs, "addTabsClosable", tabs, timer.nsecsElapsed());
+        }
+    }
+}
+
+/* Typing in the Menu: queries of one and two characters, of a few (trigrams), and fuzzy ones. */
+void
+_benchmarkFilter(BenchmarkResults& results, int maxTabs)
+{
+    const int aTabCounts[] = { 10000, 100000 };
+    const char* aQueries[][2] = {
+        { "filterOneChar",  "9" },
+        { "filterTwoChars", "99" },
+        { "filterTrigrams", "b 99" },
+        { "filterFuzzy",    "t19" }
+    };
+    const int reps = 20;
+
+    for( int tabs : aTabCounts ) {
+        if( tabs > maxTabs ) { break; }
+
+        QVector<quint64> ids(tabs);
+        for( int i = 0; i < tabs; ++i ) {
+            ids[i] = i + 1;
+        }
+        GGTabMenuModel model;
+        model.resetTabs(ids, _tabTexts(tabs));
+
+        QElapsedTimer timer;
+        for( const auto& query : aQueries ) {
+            qint64 elapsed = 0;
+            for( int i = 0; i < reps; ++i ) {
+                timer.start();
+                model.setFilter(QString(query[1]));
+                elapsed += timer.nsecsElapsed();
+                model.setFilter(QString());
+            }
+            results.add(tabs, query[0], reps, elapsed);
+        }
+    }
+}
+
+/* Long labels in scripts which need shaping, so that measuring them is not negligible. */
+QStringList
+_longTabTexts(int count)
+{
+    static const char* const aLabels[] = {
+        "\u0414\u043e\u043a\u0443\u043c\u0435\u043d\u0442 \u0431\u0435\u0437 \u043d\u0430\u0437\u0432\u0430\u043d\u0438\u044f",
+        "\u0645\u0633\u062a\u0646\u062f \u0628\u062f\u0648\u0646 \u0639\u0646\u0648\u0627\u0646",
+        "\u0905\u0928\u093e\u092e \u0926\u0938\u094d\u0924\u093e\u0935\u0947\u091c\u093c",
+        "\u7121\u984c\u306e\u30c9\u30ad\u30e5\u30e1\u30f3\u30c8"
+    };
+    QStringList texts;
+    texts.reserve(count);
+    for( int i = 0; i < count; ++i ) {
+        texts << QString::fromUtf8(aLabels[i % 4]) + QString(" %1").arg(i);
+    }
+    return texts;
+}
+
+/* Inserting tabs one by one in a batch measures their labels on the GUI thread, addTabs() in parallel. */
+void
+_benchmarkBulkInsert(BenchmarkResults& results, int maxTabs)
+{
+    const int aTabCounts[] = { 1000, 10000 };
+    for( int tabs : aTabCounts ) {
+        if( tabs > maxTabs ) { break; }
+
+        QStringList texts = _longTabTexts(tabs);
+        QElapsedTimer timer;
+        {
+            GGTabBarWidget w;
+            w.resize(800, 40);
+            w.show();
+            QApplication::processEvents();
+            timer.start();
+            w.beginUpdate();
+            for( int i = 0; i < tabs; ++i ) {
+                w.addTab(texts.at(i));
+            }
+            w.endUpdate();
+            QApplication::processEvents();
+            results.add(tabs, "addTabSerial", tabs, timer.nsecsElapsed());
+        }
+        {
+            GGTabBarWidget w;
+            w.resize(800, 40);
+            w.show();
+            QApplication::processEvents();
+            timer.start();
+            w.addTabs(texts);
+            QApplication::processEvents();
+            results.add(tabs, "addTabsParallel", tabs, timer.nsecsElapsed());
+        }
+    }
+}
+
+} // namespace
+
+/* ------------------------------------------------------------------------- */
+
+GGTabIndicatorDriver::GGTabIndicatorDriver(GGTabBar* pTabBar, QObject* parent)
+    : QObject(parent)
+    , m_pTabBar(pTabBar)
+    , m_iTick(0)
+    , m_iUpdates(0)
+{
+}
+
+/* The badges keep a single digit, so that the tabs are repainted but never laid out again. */
+void
+GGTabIndicatorDriver::tick()
+{
+    for( int i = 0; i < m_pTabBar->count(); ++i ) {
+        m_pTabBar->setTabProgress(i, (m_iTick + i) % 101);
+        m_pTabBar->setTabBadge(i, 1 + (m_iTick + i) % 9);
+    }
+    m_iUpdates += 2 * m_pTabBar->count();
+    ++m_iTick;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/*
+ * For every tab count, the bar is filled with one batch, then each case times a fixed
+ * number of operations on the filled bar, so that the cost per operation is measured
+ * at that size.
+ */
+int
+runBenchmark(const QStringList& args)
+{
+    int maxTabs = _argValue(args, "--max-tabs", "100000").toInt();
+    int maxOps = qMax(1, _argValue(args, "--ops", "200").toInt());
+    bool bVirtualized = args.contains("--virtualized");
+    bool bClosable = args.contains("--closable");
+    bool bCompact = args.contains("--compact");
+
+    std::mt19937 rng(1);
+    BenchmarkResults results;
+    QElapsedTimer timer;
+
+    QString tracePath = _argValue(args, "--trace", QString());
+    GGTabBarProfiler::instance()->setEnabled(!tracePath.isEmpty());
+
+    for( int tabs : _benchmarkTabCounts ) {
+        if( tabs > maxTabs ) { break; }
+
+        GGTabBarWidget w;
+        w.resize(800, 40);
+        w.setVirtualized(bVirtualized);
+        w.setTabsClosable(bClosable);
+        w.setCompactStorage(bCompact);
+        w.show();
+        QApplication::processEvents();
+
+        int ops = qMin(tabs, maxOps);
+        QStringList texts = _tabTexts(tabs);
+
+        qint64 rssBefore = _residentBytes();
+        timer.start();
+        w.addTabs(texts);
+        QApplication::processEvents();
+        results.add(tabs, "fill", tabs, timer.nsecsElapsed());
+        qint64 rssAfter = _residentBytes();
+        results.addMemory(tabs, (rssBefore < 0 || rssAfter < 0) ? -1 : rssAfter - rssBefore);
+
+        //Few distinct tool tips, as in bars whose tabs share their labels.
+        rssBefore = _residentBytes();
+        timer.start();
+        for( int i = 0; i < tabs; ++i ) {
+            w.setTabToolTip(i, QString("Tool tip %1").arg(i % 16));
+        }
+        results.add(tabs, "setTabToolTip", tabs, timer.nsecsElapsed());
+        rssAfter = _residentBytes();
+        results.addMemory(tabs, (rssBefore < 0 || rssAfter < 0) ? -1 : rssAfter - rssBefore, "toolTipsResident");
+        results.addMemory(tabs, w.tabMetadataBytes(), "metadata");
+
+        //The first display of the menu after a batch rebuilds it.
+        timer.start();
+        QMetaObject::invokeMethod(&w, "displayMenu");
+        _hidePopup();
+        results.add(tabs, "displayMenuCold", 1, timer.nsecsElapsed());
+
+        int menuOps = qMin(ops, 20);
+        timer.start();
+        for( int i = 0; i < menuOps; ++i ) {
+            QMetaObject::invokeMethod(&w, "displayMenu");
+            _hidePopup();
+        }
+        results.add(tabs, "displayMenu", menuOps, timer.nsecsElapsed());
+
+        QStringList extraTexts = _tabTexts(ops, tabs);
+        timer.start();
+        for( int i = 0; i < ops; ++i ) {
+            w.addTab(extraTexts.at(i));
+        }
+        results.add(tabs, "addTab", ops, timer.nsecsElapsed());
+
+        timer.start();
+        for( int i = 0; i < ops; ++i ) {
+            w.removeTab(w.count() - 1);
+        }
+        results.add(tabs, "removeTab", ops, timer.nsecsElapsed());
+
+        std::uniform_int_distribution<int> anyTab(0, tabs - 1);
+        timer.start();
+        for( int i = 0; i < ops; ++i ) {
+            w.moveTab(anyTab(rng), anyTab(rng));
+        }
+        results.add(tabs, "moveTab", ops, timer.nsecsElapsed());
+
+        //Each move is then reported by one queued tabsChanged() for all of them.
+        w.setNotificationsCoalesced(true);
+        timer.start();
+        for( int i = 0; i < ops; ++i ) {
+            w.moveTab(anyTab(rng), anyTab(rng));
+        }
+        QApplication::processEvents();
+        results.add(tabs, "moveTabCoalesced", ops, timer.nsecsElapsed());
+        w.setNotificationsCoalesced(false);
+
+        //Changing the current tab scrolls to make it visible.
+        timer.start();
+        for( int i = 0; i < ops; ++i ) {
+            w.setCurrentIndex(anyTab(rng));
+        }
+        results.add(tabs, "makeVisible", ops, timer.nsecsElapsed());
+
+        //The first repaint fills the tab pixmap cache, the next ones paint from it.
+        GGTabBar* pTabBar = w.findChild<GGTabBar*>();
+        int paintOps = qMin(ops, 50);
+        pTabBar->setTabPixmapCacheEnabled(false);
+        timer.start();
+        for( int i = 0; i < paintOps; ++i ) {
+            w.repaint();
+        }
+        results.add(tabs, "paintUncached", paintOps, timer.nsecsElapsed());
+
+        pTabBar->setTabPixmapCacheEnabled(true);
+        w.repaint();
+        timer.start();
+        for( int i = 0; i < paintOps; ++i ) {
+            w.repaint();
+        }
+        results.add(tabs, "paint", paintOps, timer.nsecsElapsed());
+
+        timer.start();
+        QByteArray session = w.saveSession();
+        results.add(tabs, "saveSession", 1, timer.nsecsElapsed());
+
+        timer.start();
+        w.restoreSession(session);
+        QApplication::processEvents();
+        results.add(tabs, "restoreSession", 1, timer.nsecsElapsed());
+
+        //Until the tabs around the current one can be used.
+        GGTabSessionLoader loader(&w);
+        timer.start();
+        loader.load(session, true);
+        results.add(tabs, "restoreSessionFirstChunk", 1, timer.nsecsElapsed());
+        loader.cancel();
+    }
+
+    if( !bVirtualized ) {
+        _benchmarkBatchInsert(results, maxTabs);
+        _benchmarkBulkInsert(results, maxTabs);
+    }
+
+    _benchmarkFilter(results, maxTabs);
+
+    int indicatorSeconds = _argValue(args, "--indicator-seconds", "3").toInt();
+    if( indicatorSeconds > 0 ) {
+        _benchmarkIndicators(results, bVirtualized, indicatorSeconds);
+    }
+
+    QJsonObject root;
+    root["benchmark"] = QString("GGTabBar");
+    root["qtVersion"] = QString(qVersion());
+    root["platform"] = QApplication::platformName();
+    root["virtualized"] = bVirtualized;
+    root["closable"] = bClosable;
+    root["compact"] = bCompact;
+    root["results"] = results.results();
+
+    if( !tracePath.isEmpty() && !GGTabBarProfiler::instance()->writeChromeTrace(tracePath) ) {
+        qWarning("Cannot write the trace to %s", qPrintable(tracePath));
+    }
+
+    return _writeJson(root, _argValue(args, "--out", QString())) ? 0 : 1;
+}
+
+/* ------------------------------------------------------------------------- */
+
+GGTabBarSignalSpy::GGTabBarSignalSpy(GGTabBarWidget* pWidget, QObject* parent)
+    : QObject(parent)
+    , m_iCurrentChanged(0)
+    , m_iTabsChanged(0)
+    , m_pWidget(pWidget)
+{
+    GGScrollableTabBar* pScrollableTabBar = pWidget->findChild<GGScrollableTabBar*>();
+
+    connect(pWidget,            &GGTabBarWidget::currentChanged,            this, &GGTabBarSignalSpy::onCurrentChanged);
+    connect(pWidget,            &GGTabBarWidget::tabMoved,                  this, &GGTabBarSignalSpy::onTabMoved);
+    connect(pWidget,            &GGTabBarWidget::tabsChanged,               this, &GGTabBarSignalSpy::onTabsChanged);
+    connect(pScrollableTabBar,  &GGScrollableTabBar::tabAdded,              this, &GGTabBarSignalSpy::onTabAdded);
+    connect(pScrollableTabBar,  &GGScrollableTabBar::tabAboutToBeRemoved,   this, &GGTabBarSignalSpy::onTabAboutToBeRemoved);
+}
+
+void
+GGTabBarSignalSpy::clear()
+{
+    m_lAdded.clear();
+    m_lRemoved.clear();
+    m_lMoved.clear();
+    m_iCurrentChanged = 0;
+    m_iTabsChanged = 0;
+}
+
+void
+GGTabBarSignalSpy::onCurrentChanged(int index)
+{
+    ++m_iCurrentChanged;
+    if( m_pWidget->isUpdating() ) {
+        m_lErrors << QString("currentChanged(%1) emitted during an update").arg(index);
+    }
+    if( index != m_pWidget->currentIndex() ) {
+        m_lErrors << QString("currentChanged(%1) while the current index is %2").arg(index).arg(m_pWidget->currentIndex());
+    }
+}
+
+void
+GGTabBarSignalSpy::onTabMoved(int from, int to)
+{
+    m_lMoved << qMakePair(from, to);
+}
+
+void
+GGTabBarSignalSpy::onTabsChanged()
+{
+    ++m_iTabsChanged;
+}
+
+void
+GGTabBarSignalSpy::onTabAdded(int index)
+{
+    m_lAdded << index;
+    if( 0 == m_pWidget->tabId(index) ) {
+        m_lErrors << QString("tabAdded(%1) for a tab without id").arg(index);
+    }
+}
+
+void
+GGTabBarSignalSpy::onTabAboutToBeRemoved(int index)
+{
+    m_lRemoved << index;
+    if( index < 0 || index >= m_pWidget->count() ) {
+        m_lErrors << QString("tabAboutToBeRemoved(%1) with %2 tabs").arg(index).arg(m_pWidget->count());
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+namespace {
+
+/*
+ * Applies random operations to a GGTabBarWidget and to a plain list of ids and texts,
+ * and checks after each of them that both agree.
+ */
+class Fuzzer
+{
+public:
+    Fuzzer(unsigned int seed)
+        : m_rng(seed)
+        , m_spy(&m_widget)
+        , m_pMenuModel(m_widget.findChild<GGTabMenuModel*>())
+    {
+        m_widget.resize(600, 40);
+        m_widget.show();
+    }
+
+    bool step(int op)
+    {
+        m_spy.clear();
+        switch( this->random(12) ) {
+        case 0:  this->addTab(true); break;
+        case 1:  this->insertTab(true); break;
+        case 2:  this->removeTab(true); break;
+        case 3:  this->moveTab(true); break;
+        case 4:  this->renameTab(); break;
+        case 5:  this->setCurrentIndex(); break;
+        case 6:  this->batch(); break;
+        case 7:  this->addTabs(); break;
+        case 8:  this->removeTabs(); break;
+        case 9:  this->removeIf(); break;
+        case 10: this->displayMenu(); break;
+        case 11: m_widget.setVirtualized(!m_widget.isVirtualized()); break;
+        }
+        this->checkState();
+
+        for( int i = 0; i < m_spy.m_lErrors.size(); ++i ) {
+            m_lFailures << QString("op %1: %2").arg(op).arg(m_spy.m_lErrors.at(i));
+        }
+        return m_lFailures.isEmpty();
+    }
+
+    inline QStringList failures() const { return m_lFailures; }
+
+private:
+    inline int random(int bound) { return bound > 0 ? int(m_rng() % unsigned(bound)) : 0; }
+
+    /* Few distinct texts, so that the menu has to order equal texts by id. */
+    inline QString randomText() { return QString("Tab %1").arg(this->random(50)); }
+
+    void expect(bool b, const QString& error)
+    {
+        if( !b ) {
+            m_spy.m_lErrors << error;
+        }
+    }
+
+    /* Keeps the bar around a few hundred tabs. */
+    inline bool tooManyTabs() const { return m_lIds.size() > 300; }
+
+    void recordInsertedTab(int index, const QString& text)
+    {
+        quint64 id = m_widget.tabId(index);
+        this->expect(0 != id && !m_setIds.contains(id), QString("new tab at %1 has id %2").arg(index).arg(id));
+        m_lIds.insert(index, id);
+        m_lTexts.insert(index, text);
+        m_setIds.insert(id);
+    }
+
+    void recordRemovedTab(int index)
+    {
+        m_setIds.remove(m_lIds.at(index));
+        m_lIds.remove(index);
+        m_lTexts.removeAt(index);
+    }
+
+    void addTab(bool bCheckSignals)
+    {
+        if( this->tooManyTabs() ) { this->removeTab(bCheckSignals); return; }
+
+        QString text = this->randomText();
+        int index = m_widget.addTab(text);
+        this->expect(index == m_lIds.size(), QString("addTab returned %1 instead of %2").arg(index).arg(m_lIds.size()));
+        this->recordInsertedTab(m_lIds.size(), text);
+        if( bCheckSignals ) {
+            this->expect(m_spy.m_lAdded == QVector<int>() << index, "addTab: unexpected tabAdded signals");
+        }
+    }
+
+    void insertTab(bool bCheckSignals)
+    {
+        if( this->tooManyTabs() ) { this->removeTab(bCheckSignals); return; }
+
+        QString text = this->randomText();
+        int index = this->random(m_lIds.size() + 1);
+        int inserted = m_widget.insertTab(index, text);
+        this->expect(inserted == index, QString("insertTab(%1) returned %2").arg(index).arg(inserted));
+        this->recordInsertedTab(index, text);
+        if( bCheckSignals ) {
+            this->expect(m_spy.m_lAdded == QVector<int>() << index, "insertTab: unexpected tabAdded signals");
+        }
+    }
+
+    void removeTab(bool bCheckSignals)
+    {
+        if( m_lIds.isEmpty() ) { return; }
+
+        int index = this->random(m_lIds.size());
+        m_widget.removeTab(index);
+        this->recordRemovedTab(index);
+        if( bCheckSignals ) {
+            this->expect(m_spy.m_lRemoved == QVector<int>() << index, "removeTab: unexpected tabAboutToBeRemoved signals");
+        }
+    }
+
+    void moveTab(bool bCheckSignals)
+    {
+        if( m_lIds.size() < 2 ) { return; }
+
+        int from = this->random(m_lIds.size());
+        int to = this->random(m_lIds.size());
+        m_widget.moveTab(from, to);
+        if( from == to ) { return; }
+
+        m_lIds.move(from, to);
+        m_lTexts.move(from, to);
+        if( bCheckSignals ) {
+            this->expect(m_spy.m_lMoved.size() == 1 && m_spy.m_lMoved.first() == qMakePair(from, to),
+                         QString("moveTab(%1, %2): unexpected tabMoved signals").arg(from).arg(to));
+        }
+    }
+
+    void renameTab()
+    {
+        if( m_lIds.isEmpty() ) { return; }
+
+        int index = this->random(m_lIds.size());
+        QString text = this->randomText();
+        m_widget.setTabText(index, text);
+        m_lTexts[index] = text;
+    }
+
+    void setCurrentIndex()
+    {
+        if( m_lIds.isEmpty() ) { return; }
+
+        int index = this->random(m_lIds.size());
+        m_widget.setCurrentIndex(index);
+        this->expect(m_widget.currentIndex() == index, QString("setCurrentIndex(%1) ignored").arg(index));
+    }
+
+    void batch()
+    {
+        m_widget.beginUpdate();
+        for( int i = this->random(20); i >= 0; --i ) {
+            switch( this->random(5) ) {
+            case 0: this->addTab(false); break;
+            case 1: this->insertTab(false); break;
+            case 2: this->removeTab(false); break;
+            case 3: this->moveTab(false); break;
+            case 4: this->renameTab(); break;
+            }
+        }
+        this->expect(0 == m_spy.m_iTabsChanged, "tabsChanged emitted during an update");
+        m_widget.endUpdate();
+        this->expect(1 == m_spy.m_iTabsChanged, QString("tabsChanged emitted %1 times for one update").arg(m_spy.m_iTabsChanged));
+    }
+
+    void addTabs()
+    {
+        if( this->tooManyTabs() ) { this->removeTabs(); return; }
+
+        QStringList texts;
+        for( int i = this->random(30); i >= 0; --i ) {
+            texts << this->randomText();
+        }
+        int index = this->random(m_lIds.size() + 1);
+        m_widget.insertTabs(index, texts);
+        for( int i = 0; i < texts.size(); ++i ) {
+            this->recordInsertedTab(index + i, texts.at(i));
+        }
+    }
+
+    void removeTabs()
+    {
+        if( m_lIds.isEmpty() ) { return; }
+
+        int index = this->random(m_lIds.size());
+        int count = 1 + this->random(qMin(30, m_lIds.size() - index));
+        m_widget.removeTabs(index, count);
+        for( int i = count - 1; i >= 0; --i ) {
+            this->recordRemovedTab(index + i);
+        }
+    }
+
+    void removeIf()
+    {
+        int modulo = 2 + this->random(5);
+        int removed = m_widget.removeIf([modulo](int index) { return 0 == index % modulo; });
+        int expected = 0;
+        for( int i = m_lIds.size() - 1; i >= 0; --i ) {
+            if( 0 == i % modulo ) {
+                this->recordRemovedTab(i);
+                ++expected;
+            }
+        }
+        this->expect(removed == expected, QString("removeIf removed %1 tabs instead of %2").arg(removed).arg(expected));
+    }
+
+    /* Displaying the menu rebuilds it if needed: it must then list every tab. */
+    void displayMenu()
+    {
+        QMetaObject::invokeMethod(&m_widget, "displayMenu");
+        _hidePopup();
+        if( !m_pMenuModel || m_lIds.isEmpty() ) { return; }
+
+        this->expect(m_pMenuModel->rowCount() == m_lIds.size(),
+                     QString("the menu lists %1 tabs instead of %2").arg(m_pMenuModel->rowCount()).arg(m_lIds.size()));
+        for( int i = 0; i < m_lIds.size(); ++i ) {
+            int row = m_pMenuModel->rowOf(m_lIds.at(i));
+            this->expect(row >= 0 && m_pMenuModel->data(m_pMenuModel->index(row)).toString() == m_lTexts.at(i),
+                         QString("tab %1 is missing from the menu").arg(m_lIds.at(i)));
+        }
+        for( int row = 1; row < m_pMenuModel->rowCount(); ++row ) {
+            QString previous = m_pMenuModel->data(m_pMenuModel->index(row - 1)).toString();
+            QString text = m_pMenuModel->data(m_pMenuModel->index(row)).toString();
+            this->expect(!(text < previous), QString("the menu is not sorted at row %1").arg(row));
+        }
+    }
+
+    void checkState()
+    {
+        int count = m_widget.count();
+        this->expect(count == m_lIds.size(), QString("%1 tabs instead of %2").arg(count).arg(m_lIds.size()));
+        if( count != m_lIds.size() ) { return; }
+
+        for( int i = 0; i < count; ++i ) {
+            this->expect(m_widget.tabId(i) == m_lIds.at(i), QString("tab %1 has id %2 instead of %3").arg(i).arg(m_widget.tabId(i)).arg(m_lIds.at(i)));
+            this->expect(m_widget.tabIndex(m_lIds.at(i)) == i, QString("tabIndex(%1) is %2 instead of %3").arg(m_lIds.at(i)).arg(m_widget.tabIndex(m_lIds.at(i))).arg(i));
+            this->expect(m_widget.tabText(i) == m_lTexts.at(i), QString("tab %1 has text '%2' instead of '%3'").arg(i).arg(m_widget.tabText(i)).arg(m_lTexts.at(i)));
+        }
+
+        int current = m_widget.currentIndex();
+        this->expect(0 == count ? -1 == current : (current >= 0 && current < count),
+                     QString("current index %1 with %2 tabs").arg(current).arg(count));
+        this->expect(!m_widget.isUpdating(), "still updating");
+    }
+
+private:
+    std::mt19937        m_rng;
+    GGTabBarWidget      m_widget;
+    GGTabBarSignalSpy   m_spy;
+    GGTabMenuModel*     m_pMenuModel;
+
+    QVector<quint64>    m_lIds;
+    QStringList         m_lTexts;
+    QSet<quint64>       m_setIds;
+    QStringList         m_lFailures;
+};
+
+} // namespace
+
+int
+runFuzzer(const QStringList& args)
+{
+    unsigned int seed = _argValue(args, "--seed", "1").toUInt();
+    int ops = _argValue(args, "--ops", "10000").toInt();
+
+    Fuzzer fuzzer(seed);
+    QApplication::processEvents();
+
+    int executed = 0;
+    while( executed < ops && fuzzer.step(executed) ) {
+        ++executed;
+        if( 0 == executed % 100 ) {
+            QApplication::processEvents();
+        }
+    }
+
+    QJsonObject root;
+    root["fuzzer"] = QString("GGTabBar");
+    root["seed"] = double(seed);
+    root["ops"] = ops;
+    root["executed"] = executed;
+    root["failures"] = QJsonArray::fromStringList(fuzzer.failures());
+
+    bool bWritten = _writeJson(root, _argValue(args, "--out", QString()));
+    return (bWritten && fuzzer.failures().isEmpty()) ? 0 : 1;
+}
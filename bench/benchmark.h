@@ -0,0 +1,81 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QObject>
+#include <QPair>
+#include <QStringList>
+#include <QVector>
+
+class GGTabBar;
+class GGTabBarWidget;
+
+/**
+ * Headless benchmarks and randomized checks of the tab bar classes, run by the GGTabBarBench
+ * application. Use QT_QPA_PLATFORM=offscreen to run them without a display.
+ *
+ *   GGTabBarBench [--max-tabs N] [--ops N] [--indicator-seconds N] [--virtualized] [--closable]
+ *                 [--compact] [--out file.json] [--trace trace.json]
+ *   GGTabBarBench --fuzz [--seed S] [--ops N] [--out file.json]
+ *
+ * The results are written as JSON, to the standard output by default. With --trace, the
+ * operations recorded by GGTabBarProfiler are written as a Chrome trace, which requires
+ * a build with GG_TABBAR_INSTRUMENTATION.
+ * Both return the exit code of the application: non zero if the fuzzer found a failure.
+ */
+int runBenchmark(const QStringList& args);
+int runFuzzer(const QStringList& args);
+
+/**
+ * Sets the progress and badge of every tab of a GGTabBar on each tick() for the benchmark.
+ */
+class GGTabIndicatorDriver : public QObject
+{
+    Q_OBJECT
+
+public:
+    GGTabIndicatorDriver(GGTabBar* pTabBar, QObject* parent = nullptr);
+
+    inline int updates() const { return m_iUpdates; }
+
+public slots:
+    void tick();
+
+private:
+    GGTabBar*   m_pTabBar;
+    int         m_iTick;
+    int         m_iUpdates;
+};
+
+/**
+ * Records the signals of a GGTabBarWidget and of its GGScrollableTabBar for the fuzzer,
+ * and checks the invariants that must hold when they are emitted.
+ */
+class GGTabBarSignalSpy : public QObject
+{
+    Q_OBJECT
+
+public:
+    GGTabBarSignalSpy(GGTabBarWidget* pWidget, QObject* parent = nullptr);
+
+    void clear();
+
+public slots:
+    void onCurrentChanged(int index);
+    void onTabMoved(int from, int to);
+    void onTabsChanged();
+    void onTabAdded(int index);
+    void onTabAboutToBeRemoved(int index);
+
+public:
+    QVector<int>                m_lAdded;
+    QVector<int>                m_lRemoved;
+    QVector<QPair<int, int> >   m_lMoved;
+    int                         m_iCurrentChanged;
+    int                         m_iTabsChanged;
+    QStringList                 m_lErrors;
+
+private:
+    GGTabBarWidget*             m_pWidget;
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,13 @@
+#include "benchmark.h"
+#include <QApplication>
+
+int main(int argc, char *argv[])
+{
+    QApplication a(argc, argv);
+
+    QStringList args = a.arguments();
+    if( args.contains("--fuzz") ) {
+        return runFuzzer(args);
+    }
+    return runBenchmark(args);
+}
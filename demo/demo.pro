@@ -0,0 +1,11 @@
+TEMPLATE = app
+TARGET   = GGTabBar
+
+include(../GGTabBar.pri)
+
+SOURCES += \
+        main.cpp \
+        mainwindow.cpp
+
+HEADERS += \
+        mainwindow.h
@@ -0,0 +1,31 @@
+#include "mainwindow.h"
+
+#include "GGTabBar.h"
+
+#include <QLabel>
+#include <QShortcut>
+
+MainWindow::MainWindow(QWidget *parent)
+    : QMainWindow(parent)
+{
+    GGTabBarWidget* tbw = new GGTabBarWidget(this);
+    tbw->addTabs(QStringList() << "Tab1" << "Tab2" << "Tab3" << "Tab4" << "Tab5" << "Tab6");
+    tbw->setPageFactory([tbw](quint64 id, const QByteArray&) {
+        QLabel* pPage = new QLabel(tbw->tabText(tbw->tabIndex(id)));
+        pPage->setAlignment(Qt::AlignCenter);
+        return pPage;
+    });
+
+    //Closed tabs can be reopened with Ctrl+Shift+T.
+    tbw->setTabsClosable(true);
+    connect(tbw, &GGTabBarWidget::tabCloseRequested, tbw, &GGTabBarWidget::closeTab);
+    QShortcut* pReopenShortcut = new QShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_T), this);
+    connect(pReopenShortcut, &QShortcut::activated, tbw, &GGTabBarWidget::reopenLastClosed);
+
+    this->setCentralWidget(tbw);
+}
+
+MainWindow::~MainWindow()
+{
+
+}
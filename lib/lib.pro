@@ -0,0 +1,26 @@
+TEMPLATE = lib
+CONFIG  += staticlib
+TARGET   = GGTabBar
+
+include(../GGTabBar.pri)
+
+SOURCES += \
+        ../GGTabBar.cpp \
+        ../GGTabBarProfiler.cpp \
+        ../GGTabIconCache.cpp \
+        ../GGTabMenu.cpp \
+        ../GGTabSearchIndex.cpp \
+        ../GGTabSession.cpp \
+        ../GGTabUpdateQueue.cpp
+
+HEADERS += \
+        ../GGTabBar.h \
+        ../GGTabBarProfiler.h \
+        ../GGInternPool.h \
+        ../GGRankedSet.h \
+        ../GGRecencyList.h \
+        ../GGTabIconCache.h \
+        ../GGTabMenu.h \
+        ../GGTabSearchIndex.h \
+        ../GGTabSession.h \
+        ../GGTabUpdateQueue.h